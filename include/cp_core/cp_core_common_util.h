@@ -35,6 +35,9 @@ void attempt_local_accept_to_help(loc_entry_t *loc_entry,
 void attempt_local_accept(loc_entry_t *loc_entry,
                           uint16_t t_id);
 
+void inspect_quorum_read_if_ready_to_inspect(cp_core_ctx_t *cp_core_ctx,
+                                             loc_entry_t *loc_entry);
+
 
 
 
@@ -76,7 +79,7 @@ static inline bool if_already_committed_bcast_commits(loc_entry_t *loc_entry,
                                                       uint16_t t_id)
 {
   check_loc_entry_if_already_committed(loc_entry);
-  if (loc_entry->rmw_id.id <= committed_glob_sess_rmw_id[loc_entry->glob_sess_id]) {
+  if (loc_entry->rmw_id.id <= committed_glob_sess_rmw_id(loc_entry->glob_sess_id)) {
     //my_printf(yellow, "Wrkr %u, sess: %u Bcast rmws %u \n", t_id, loc_entry->sess_id);
     loc_entry->log_no = loc_entry->accepted_log_no;
     loc_entry->state = MUST_BCAST_COMMITS;
@@ -111,8 +114,69 @@ static inline void fill_loc_rmw_entry_on_grabbing_kv_ptr(loc_entry_t *loc_entry,
   loc_entry->state = state;
   loc_entry->new_ts.version = version;
   loc_entry->new_ts.m_id = (uint8_t) machine_id;
+  loc_entry->on_lease = false; // only the first try may accept on the proposer lease
+}
+
+
+// The session's staging buffer for the value its accepts and commits carry:
+// the result of the RMW, or the value read if a CAS failed.
+// A helping entry always stages what it helps in value_to_write, and so does a partial-value RMW,
+// which reads back only its own bytes
+static inline uint8_t *staged_rmw_value(loc_entry_t *loc_entry,
+                                        bool helping)
+{
+  return (PARTIAL_VALUE_RMWS || helping || loc_entry->rmw_is_successful) ?
+         loc_entry->value_to_write : loc_entry->value_to_read;
+}
+
+// The bytes of the value the RMW works on
+static inline uint8_t *rmw_bytes_of_value(uint8_t *value, uint16_t val_offset)
+{
+  return PARTIAL_VALUE_RMWS ? value + val_offset : value;
 }
 
+// The client always reads back the value the operator was applied on
+static inline void apply_rmw_operator(mica_op_t *kv_ptr,
+                                      loc_entry_t *loc_entry)
+{
+  memcpy(loc_entry->value_to_read, kv_ptr->value, (size_t) RMW_VALUE_SIZE);
+  memcpy(loc_entry->value_to_write, kv_ptr->value, (size_t) RMW_VALUE_SIZE);
+  memcpy(&loc_entry->rmw_operand, loc_entry->compare_val, sizeof(uint64_t));
+  rmw_operator_t rmw_operator = rmw_operators[loc_entry->opcode - RMW_OPERATOR_BASE];
+  loc_entry->rmw_is_successful = rmw_operator(loc_entry->value_to_write, loc_entry->compare_val,
+                                              (uint32_t) loc_entry->rmw_val_len);
+}
+
+// value_to_write gets the whole new value, value_to_read only the bytes of the RMW as they were
+static inline void perform_the_rmw_on_value_bytes(mica_op_t *kv_ptr,
+                                                  loc_entry_t *loc_entry)
+{
+  uint32_t len = loc_entry->rmw_val_len;
+  uint8_t *bytes = loc_entry->value_to_write + loc_entry->val_offset;
+  uint8_t *kv_bytes = kv_ptr->value + loc_entry->val_offset;
+  memcpy(loc_entry->value_to_write, kv_ptr->value, (size_t) RMW_VALUE_SIZE);
+  memcpy(loc_entry->value_to_read, kv_bytes, len);
+
+  switch (loc_entry->opcode) {
+    case RMW_PLAIN_WRITE:
+      memcpy(bytes, loc_entry->swap_val, len);
+      break;
+    case FETCH_AND_ADD:
+      loc_entry->rmw_operand = (*(uint64_t *)loc_entry->compare_val) + loc_entry->combined_addend;
+      *(uint64_t *) bytes += loc_entry->rmw_operand;
+      break;
+    case COMPARE_AND_SWAP_WEAK:
+    case COMPARE_AND_SWAP_STRONG:
+      loc_entry->rmw_is_successful = memcmp(loc_entry->compare_val, kv_bytes, len) == 0;
+      if (loc_entry->rmw_is_successful) memcpy(bytes, loc_entry->swap_val, len);
+      break;
+    default:
+      if (ENABLE_ASSERTIONS) assert(opcode_is_rmw_operator(loc_entry->opcode));
+      memcpy(&loc_entry->rmw_operand, loc_entry->compare_val, sizeof(uint64_t));
+      loc_entry->rmw_is_successful =
+          rmw_operators[loc_entry->opcode - RMW_OPERATOR_BASE](bytes, loc_entry->compare_val, len);
+  }
+}
 
 // Perform the operation of the RMW and store the result in the local entry, call on locally accepting
 static inline void perform_the_rmw_on_the_loc_entry(mica_op_t *kv_ptr,
@@ -123,12 +187,24 @@ static inline void perform_the_rmw_on_the_loc_entry(mica_op_t *kv_ptr,
   loc_entry->base_ts = kv_ptr->ts;
   loc_entry->accepted_log_no = kv_ptr->log_no;
 
+  if (PARTIAL_VALUE_RMWS) {
+    perform_the_rmw_on_value_bytes(kv_ptr, loc_entry);
+    write_kv_ptr_acc_val(kv_ptr, staged_rmw_value(loc_entry, false), (size_t) RMW_VALUE_SIZE);
+    return;
+  }
+
   switch (loc_entry->opcode) {
     case RMW_PLAIN_WRITE:
       break;
     case FETCH_AND_ADD:
       memcpy(loc_entry->value_to_read, kv_ptr->value, loc_entry->rmw_val_len);
-      *(uint64_t *)loc_entry->value_to_write = (*(uint64_t *)loc_entry->value_to_read) + (*(uint64_t *)loc_entry->compare_val);
+      // a receiver of the shipped F&A rebuilds the value out of its own, the rest must match
+      if (SHIP_RMW_OPS_IN_COMMITS) {
+        memcpy(loc_entry->value_to_write, kv_ptr->value, (size_t) RMW_VALUE_SIZE);
+        loc_entry->rmw_operand = (*(uint64_t *)loc_entry->compare_val) + loc_entry->combined_addend;
+      }
+      *(uint64_t *)loc_entry->value_to_write = (*(uint64_t *)loc_entry->value_to_read) + (*(uint64_t *)loc_entry->compare_val) +
+                                               loc_entry->combined_addend;
       if (ENABLE_ASSERTIONS && !ENABLE_CLIENTS && RMW_RATIO >= 1000)
         assert((*(uint64_t *)loc_entry->compare_val == 1));
       //printf("%u %lu \n", loc_entry->log_no, *(uint64_t *)loc_entry->value_to_write);
@@ -144,20 +220,241 @@ static inline void perform_the_rmw_on_the_loc_entry(mica_op_t *kv_ptr,
       }
       break;
     default:
+      if (opcode_is_rmw_operator(loc_entry->opcode)) {
+        apply_rmw_operator(kv_ptr, loc_entry);
+        break;
+      }
       if (ENABLE_ASSERTIONS) assert(false);
   }
   // we need to remember the last accepted value
-  if (loc_entry->rmw_is_successful) {
-    write_kv_ptr_acc_val(kv_ptr, loc_entry->value_to_write, (size_t) RMW_VALUE_SIZE);
-  }
-  else {
-    write_kv_ptr_acc_val(kv_ptr, loc_entry->value_to_read, (size_t) RMW_VALUE_SIZE);
+  write_kv_ptr_acc_val(kv_ptr, staged_rmw_value(loc_entry, false), (size_t) RMW_VALUE_SIZE);
+}
+
+
+
+
+/*--------------------------------------------------------------------------
+ * --------------------PROPOSER LEASES-------------------------------------
+ * --------------------------------------------------------------------------*/
+
+// Promising a ballot for a log number also leases it to its proposer for the next
+// PROPOSER_LEASE_SLOTS log numbers: until a higher ballot revokes it, no other proposer
+// can be promised or accepted with a ballot that is not higher than the lease
+static inline void grant_proposer_lease(mica_op_t *kv_ptr,
+                                        ts_tuple_t *ts,
+                                        uint32_t log_no)
+{
+  if (!PROPOSER_LEASE_SLOTS) return;
+  kv_ptr->lease_ts = *ts;
+  kv_ptr->lease_end_log = log_no + PROPOSER_LEASE_SLOTS;
+  kv_ptr->lease_confirmed = false;
+  kv_ptr->lease_revoked = false;
+}
+
+// A local proposal for a log number that another machine holds the lease of must outbid the lease
+static inline uint32_t version_outbidding_proposer_lease(mica_op_t *kv_ptr,
+                                                         uint32_t version,
+                                                         uint32_t log_no)
+{
+  if (!PROPOSER_LEASE_SLOTS) return version;
+  bool foreign_lease = kv_ptr->lease_ts.m_id != machine_id && !kv_ptr->lease_revoked &&
+                       log_no <= kv_ptr->lease_end_log;
+  if (foreign_lease && version <= kv_ptr->lease_ts.version)
+    return kv_ptr->lease_ts.version + 1;
+  return version;
+}
+
+// The lease is ours, a quorum has promised it and it still covers the next log number:
+// the RMW can skip the proposes and go straight to accepting with the leased ballot
+static inline bool can_use_proposer_lease(mica_op_t *kv_ptr,
+                                          loc_entry_t *loc_entry)
+{
+  if (!PROPOSER_LEASE_SLOTS || loc_entry->all_aboard) return false;
+  return kv_ptr->lease_confirmed && !kv_ptr->lease_revoked &&
+         kv_ptr->lease_ts.m_id == machine_id &&
+         kv_ptr->last_committed_log_no + 1 <= kv_ptr->lease_end_log;
+}
+
+/*--------------------------------------------------------------------------
+ * --------------------QUORUM READS-----------------------------------------
+ * --------------------------------------------------------------------------*/
+
+// The highest log number of the key that holds an accepted but not yet committed value, 0 if none
+static inline uint32_t newest_uncommitted_accepted_log_no(mica_op_t *kv_ptr)
+{
+  return kv_ptr->accepted_log_no > kv_ptr->last_committed_log_no ?
+         kv_ptr->accepted_log_no : 0;
+}
+
+// Fold the committed state a machine reports into the quorum read: the entry keeps the newest
+// committed value it has seen, and counts in acks the machines that agree on it
+static inline void quorum_read_gathers_rep(loc_entry_t *loc_entry,
+                                           uint32_t log_no,
+                                           ts_tuple_t *ts,
+                                           uint8_t *value,
+                                           uint32_t acc_log_no)
+{
+  rmw_rep_info_t *rep_info = &loc_entry->rmw_reps;
+  rep_info->tot_replies++;
+  if (rep_info->tot_replies >= QUORUM_NUM) rep_info->ready_to_inspect = true;
+  loc_entry->accepted_log_no = MAX(loc_entry->accepted_log_no, acc_log_no);
+
+  compare_t ts_comp = compare_ts(ts, &loc_entry->base_ts);
+  bool is_newer = rep_info->acks == 0 || log_no > loc_entry->log_no ||
+                  (log_no == loc_entry->log_no && ts_comp == GREATER);
+  if (is_newer) {
+    loc_entry->log_no = log_no;
+    loc_entry->base_ts = *ts;
+    memcpy(loc_entry->value_to_read, value, (size_t) RMW_VALUE_SIZE);
+    rep_info->acks = 1;
   }
+  else if (log_no == loc_entry->log_no && ts_comp == EQUAL)
+    rep_info->acks++;
+}
+
+// A quorum has committed the newest value seen, and nothing newer may have been chosen
+static inline bool quorum_read_is_decided(loc_entry_t *loc_entry)
+{
+  return loc_entry->rmw_reps.acks >= QUORUM_NUM &&
+         loc_entry->accepted_log_no <= loc_entry->log_no;
+}
+
+// The addend of the F&A of 0 that a read falls back to, when it must be linearized through Paxos
+static uint8_t read_zero_addend[RMW_VALUE_SIZE];
+
+static inline void read_becomes_zero_fetch_and_add(trace_op_t *op)
+{
+  op->opcode = FETCH_AND_ADD;
+  op->value_to_write = read_zero_addend;
+  op->attempt_all_aboard = false;
+}
+
+// A read that completes without Paxos
+static inline void complete_read_without_rmw(sess_stall_t *stall_info,
+                                             uint16_t sess_id,
+                                             uint32_t index_to_req_array,
+                                             uint8_t *value,
+                                             uint16_t t_id)
+{
+  fill_req_array_when_after_rmw(sess_id, index_to_req_array, KVS_OP_GET,
+                                value, true, t_id);
+  signal_completion_to_client(sess_id, index_to_req_array, t_id);
+  stall_info->stalled[sess_id] = false;
+  stall_info->all_stalled = false;
+}
+
+/*--------------------------------------------------------------------------
+ * --------------------READ LEASES-----------------------------------------
+ * --------------------------------------------------------------------------*/
+
+static inline bool is_read_lease_holder(mica_op_t *kv_ptr, uint8_t m_id)
+{
+  return kv_ptr->key.bkt % MACHINE_NUM == m_id;
+}
+
+// Accepting a value of the designated replica promises it the key for READ_LEASE_NS.
+// The promise starts unconfirmed, even when the designated replica makes it to itself
+static inline void promise_read_lease(mica_op_t *kv_ptr, uint8_t m_id)
+{
+  if (!READ_LEASES || !is_read_lease_holder(kv_ptr, m_id)) return;
+  kv_ptr->epoch_id = (cp_clock_ns() + READ_LEASE_NS) << 1;
+}
+
+// While the promise lasts, only the designated replica may have a value accepted,
+// either by a remote accept or by grabbing the kv_ptr and accepting locally
+static inline bool read_lease_blocks_accept(mica_op_t *kv_ptr, uint8_t m_id)
+{
+  if (!READ_LEASES || is_read_lease_holder(kv_ptr, m_id)) return false;
+  return cp_clock_ns() < (kv_ptr->epoch_id >> 1);
+}
+
+static inline void promise_read_lease_on_local_accept(mica_op_t *kv_ptr,
+                                                      loc_entry_t *loc_entry)
+{
+  promise_read_lease(kv_ptr, (uint8_t) machine_id);
+  loc_entry->epoch_id = kv_ptr->epoch_id;
+}
 
+// The accept that made the promise has gathered a quorum of acks and its RMW has committed
+// locally: unless a newer local accept has renewed the promise, the lease can serve reads
+static inline void confirm_read_lease(loc_entry_t *loc_entry,
+                                      uint16_t t_id)
+{
+  mica_op_t *kv_ptr = loc_entry->kv_ptr;
+  if (!READ_LEASES || !is_read_lease_holder(kv_ptr, (uint8_t) machine_id)) return;
+  lock_kv_ptr(kv_ptr, t_id);
+  if (kv_ptr->epoch_id == loc_entry->epoch_id)
+    kv_ptr->epoch_id |= READ_LEASE_CONFIRMED;
+  unlock_kv_ptr(kv_ptr, t_id);
+}
+
+// A quorum read of the designated replica promises the lease like an accept does, without taking a
+// log slot: once decided on the value the replica has committed, no other value can have been chosen
+// without the promises of its quorum, so the lease can serve reads
+static inline void confirm_read_lease_on_quorum_read(loc_entry_t *loc_entry,
+                                                     uint16_t t_id)
+{
+  mica_op_t *kv_ptr = loc_entry->kv_ptr;
+  if (!READ_LEASES || !is_read_lease_holder(kv_ptr, (uint8_t) machine_id)) return;
+  lock_kv_ptr(kv_ptr, t_id);
+  if (kv_ptr->epoch_id == loc_entry->epoch_id &&
+      kv_ptr->last_committed_log_no == loc_entry->log_no)
+    kv_ptr->epoch_id |= READ_LEASE_CONFIRMED;
+  unlock_kv_ptr(kv_ptr, t_id);
+}
+
+// The ns the promise has left, sent back to the machine whose accept it nacked
+static inline uint64_t read_lease_ns_left(mica_op_t *kv_ptr)
+{
+  uint64_t now = cp_clock_ns(), end = kv_ptr->epoch_id >> 1;
+  return end > now ? end - now : 0;
 }
 
+// A nacked proposer does not retry before the lease that nacked it runs out
+static inline void wait_out_read_lease(loc_entry_t *loc_entry)
+{
+  if (!READ_LEASES || loc_entry->rmw_reps.read_lease_wait_ns == 0) return;
+  loc_entry->read_lease_wait_end = cp_clock_ns() + loc_entry->rmw_reps.read_lease_wait_ns;
+}
 
+static inline bool waits_out_read_lease(loc_entry_t *loc_entry)
+{
+  if (!READ_LEASES || loc_entry->read_lease_wait_end == 0) return false;
+  if (cp_clock_ns() < loc_entry->read_lease_wait_end) return true;
+  loc_entry->read_lease_wait_end = 0;
+  return false;
+}
 
+static inline bool read_lease_is_valid(uint64_t epoch_id)
+{
+  return (epoch_id & READ_LEASE_CONFIRMED) &&
+         cp_clock_ns() + READ_LEASE_GUARD_NS < (epoch_id >> 1);
+}
+
+// Read the value under the seqlock without taking it: the read counts only if
+// no writer has held the kv_ptr meanwhile
+static inline bool read_lease_serves_read(mica_op_t *kv_ptr, uint8_t *value)
+{
+  uint64_t seq;
+  bool valid;
+  do {
+    seq = read_seqbegin(&kv_ptr->seqlock);
+    valid = read_lease_is_valid(kv_ptr->epoch_id);
+    if (valid) memcpy(value, kv_ptr->value, (size_t) RMW_VALUE_SIZE);
+  } while (read_seqretry(&kv_ptr->seqlock, seq));
+  return valid;
+}
+
+// LAZY_COMMITS: remember the last commit of the kv_ptr, to name it in the messages of the next log
+// without taking the kv_ptr lock to fill them. The kv_ptr must be locked
+static inline void loc_entry_keeps_last_commit(mica_op_t *kv_ptr,
+                                               loc_entry_t *loc_entry)
+{
+#if LAZY_COMMITS
+  loc_entry->prev_committed_rmw_id = kv_ptr->last_committed_rmw_id.id;
+  loc_entry->prev_committed_log_no = kv_ptr->last_committed_log_no;
+#endif
+}
 
 // Activate the entry that belongs to a given key to initiate an RMW (either a local or a remote)
 static inline void activate_kv_pair(uint8_t state, uint32_t new_version, mica_op_t *kv_ptr,
@@ -173,13 +470,19 @@ static inline void activate_kv_pair(uint8_t state, uint32_t new_version, mica_op
   kv_ptr->rmw_id.id = rmw_id;
   kv_ptr->state = state;
   kv_ptr->log_no = log_no;
+  if (loc_entry != NULL) loc_entry_keeps_last_commit(kv_ptr, loc_entry);
 
-  if (state == ACCEPTED) {
+  if (state == PROPOSED)
+    grant_proposer_lease(kv_ptr, &kv_ptr->prop_ts, log_no);
+  else if (state == ACCEPTED) {
     check_activate_kv_pair_accepted(kv_ptr, new_version, new_ts_m_id);
     kv_ptr->accepted_ts = kv_ptr->prop_ts;
     kv_ptr->accepted_log_no = log_no;
-    if (loc_entry != NULL && loc_entry->all_aboard) {
+    if (loc_entry != NULL) promise_read_lease_on_local_accept(kv_ptr, loc_entry);
+    else promise_read_lease(kv_ptr, new_ts_m_id);
+    if (loc_entry != NULL && (loc_entry->all_aboard || loc_entry->on_lease)) {
       perform_the_rmw_on_the_loc_entry(kv_ptr, loc_entry, t_id);
+      kv_ptr->base_acc_ts = kv_ptr->ts;
     }
   }
   check_after_activate_kv_pair(kv_ptr, message, state, t_id);
@@ -195,6 +498,92 @@ static inline void advance_loc_entry_l_id(loc_entry_t *loc_entry,
   if (ENABLE_ASSERTIONS) assert(loc_entry->l_id % SESSIONS_PER_THREAD == loc_entry->sess_id);
 }
 
+/*--------------------------------------------------------------------------
+ * --------------------RETRY BACK-OFF--------------------------------------
+ * --------------------------------------------------------------------------*/
+
+static inline uint32_t next_back_off_rand(loc_entry_t *loc_entry)
+{
+  uint32_t x = loc_entry->back_off_rand;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  loc_entry->back_off_rand = x;
+  return x;
+}
+
+// Dueling proposers keep outbidding each other: each nacked retry doubles
+// the window its back-off is drawn from, up to the cap
+static inline void arm_retry_back_off(loc_entry_t *loc_entry)
+{
+  if (!RETRY_BACK_OFF) return;
+  uint32_t shift = MIN(loc_entry->nacked_retries, 16);
+  uint32_t window = MIN((uint32_t) cp_params.retry_back_off_base << shift,
+                        (uint32_t) cp_params.retry_back_off_cap);
+  loc_entry->retry_back_off = next_back_off_rand(loc_entry) % window;
+  if (loc_entry->nacked_retries < UINT16_MAX) loc_entry->nacked_retries++;
+}
+
+/*--------------------------------------------------------------------------
+ * --------------------AGE PRIORITY----------------------------------------
+ * --------------------------------------------------------------------------*/
+
+static inline void rmw_loses_a_round(loc_entry_t *loc_entry)
+{
+  if (AGE_PRIORITY && loc_entry->priority < UINT8_MAX) loc_entry->priority++;
+}
+
+static inline void kv_ptr_takes_priority(mica_op_t *kv_ptr, uint8_t priority)
+{
+#if AGE_PRIORITY
+  kv_ptr->prop_priority = priority;
+#endif
+}
+
+// The kv_ptr holds the proposal of an RMW older than the one asking for it
+static inline bool older_rmw_holds_kv_ptr(mica_op_t *kv_ptr, uint8_t priority)
+{
+#if AGE_PRIORITY
+  return kv_ptr->state == PROPOSED && kv_ptr->prop_priority > priority;
+#else
+  return false;
+#endif
+}
+
+// Set up the entry for a new RMW of its session: a new rmw-id and l_id, and no replies or helping
+static inline void reset_loc_entry_for_new_rmw(loc_entry_t* loc_entry,
+                                               uint16_t t_id)
+{
+  loc_entry->fp_detected = false;
+  loc_entry->rmw_is_successful = false;
+  loc_entry->on_lease = false;
+  loc_entry->contended = false;
+  loc_entry->avoid_val_in_com = false;
+  loc_entry->ships_rmw_op = false;
+  loc_entry->full_val_in_accs = false;
+  loc_entry->base_ts_found = false;
+  loc_entry->completed_early = false;
+  loc_entry->serves_read = false;
+  loc_entry->all_aboard_time_out = 0;
+  loc_entry->thrifty_time_out = 0;
+  loc_entry->thrifty_sent = false;
+  memset(&loc_entry->rmw_reps, 0, sizeof(struct rmw_rep_info));
+
+  loc_entry->back_off_cntr = 0;
+  loc_entry->retry_back_off = 0;
+  loc_entry->read_lease_wait_end = 0;
+  loc_entry->nacked_retries = 0;
+  loc_entry->priority = 0;
+  loc_entry->combined_addend = 0;
+  loc_entry->log_too_high_cntr = 0;
+  loc_entry->helping_flag = NOT_HELPING;
+  loc_entry->rmw_id.id+= GLOBAL_SESSION_NUM;
+  advance_loc_entry_l_id(loc_entry, t_id);
+  loc_entry->accepted_log_no = 0;
+  loc_entry->help_loc_entry->state = INVALID_RMW;
+  check_loc_entry_init_rmw_id(loc_entry, t_id);
+}
+
 // Initialize a local  RMW entry on the first time it gets allocated
 static inline void init_loc_entry(trace_op_t *op,
                                   uint16_t t_id,
@@ -210,25 +599,136 @@ static inline void init_loc_entry(trace_op_t *op,
   else if (op->opcode == FETCH_AND_ADD) {
     loc_entry->compare_val = op->value_to_write; // value to be added
   }
-  loc_entry->fp_detected = false;
+  else if (opcode_is_rmw_operator(op->opcode))
+    loc_entry->compare_val = op->value_to_write; // the operand
+  loc_entry->swap_val = op->value_to_write;
+  loc_entry->val_offset = PARTIAL_VALUE_RMWS ? op->val_offset : (uint16_t) 0;
   loc_entry->rmw_val_len = op->real_val_len;
-  loc_entry->rmw_is_successful = false;
   loc_entry->all_aboard = ENABLE_ALL_ABOARD && op->attempt_all_aboard;
-  loc_entry->avoid_val_in_com = false;
-  loc_entry->base_ts_found = false;
-  loc_entry->all_aboard_time_out = 0;
   memcpy(&loc_entry->key, &op->key, KEY_SIZE);
-  memset(&loc_entry->rmw_reps, 0, sizeof(struct rmw_rep_info));
   loc_entry->index_to_req_array = op->index_to_req_array;
+  reset_loc_entry_for_new_rmw(loc_entry, t_id);
+}
 
+// A quorum read arms the entry for the kv_ptr it reads: a new l_id drops the replies of any
+// earlier round of the entry, and the replies, the helping and the thrifty state start over
+static inline void rearm_loc_entry_for_quorum_read(loc_entry_t *loc_entry,
+                                                   mica_op_t *kv_ptr,
+                                                   uint16_t t_id)
+{
+  loc_entry->kv_ptr = kv_ptr;
+  memcpy(&loc_entry->key, &kv_ptr->key, KEY_SIZE);
+  loc_entry->accepted_log_no = 0;
   loc_entry->back_off_cntr = 0;
-  loc_entry->log_too_high_cntr = 0;
+  loc_entry->thrifty_time_out = 0;
+  loc_entry->thrifty_sent = false;
   loc_entry->helping_flag = NOT_HELPING;
-  loc_entry->rmw_id.id+= GLOBAL_SESSION_NUM;
-  advance_loc_entry_l_id(loc_entry, t_id);
-  loc_entry->accepted_log_no = 0;
   loc_entry->help_loc_entry->state = INVALID_RMW;
-  check_loc_entry_init_rmw_id(loc_entry, t_id);
+  memset(&loc_entry->rmw_reps, 0, sizeof(rmw_rep_info_t));
+  advance_loc_entry_l_id(loc_entry, t_id);
+  loc_entry->state = QUORUM_READ;
+}
+
+// The committed state of the local kv_ptr counts as the local reply of the quorum read
+static inline void quorum_read_gathers_local_rep(loc_entry_t *loc_entry,
+                                                 mica_op_t *kv_ptr,
+                                                 uint16_t t_id)
+{
+  uint8_t value[RMW_VALUE_SIZE];
+  lock_kv_ptr(kv_ptr, t_id);
+  ts_tuple_t ts = kv_ptr->ts;
+  uint32_t log_no = kv_ptr->last_committed_log_no;
+  uint32_t acc_log_no = newest_uncommitted_accepted_log_no(kv_ptr);
+  memcpy(value, kv_ptr->value, (size_t) RMW_VALUE_SIZE);
+  promise_read_lease_on_local_accept(kv_ptr, loc_entry);
+  unlock_kv_ptr(kv_ptr, t_id);
+
+  quorum_read_gathers_rep(loc_entry, log_no, &ts, value, acc_log_no);
+}
+
+/*--------------------------------------------------------------------------
+ * --------------------STRIPED COUNTERS-------------------------------------
+ * --------------------------------------------------------------------------*/
+
+// The quorum reads of the stripes of a counter travel together: stripe s takes the s-th of the
+// COUNTER_STRIPES l_ids the entry is armed with, and loc_entry->l_id is the last of them
+static inline uint64_t stripe_read_l_id(loc_entry_t *loc_entry,
+                                        uint16_t stripe)
+{
+  return loc_entry->l_id - (uint64_t) (COUNTER_STRIPES - 1 - stripe) * SESSIONS_PER_THREAD;
+}
+
+// The stripe whose quorum read has l_id, -1 if the entry does not sum stripes or l_id is not of its reads
+static inline int stripe_of_read_l_id(loc_entry_t *loc_entry,
+                                      uint64_t l_id)
+{
+  if (loc_entry->stripe_kv_ptrs == NULL || l_id > loc_entry->l_id ||
+      loc_entry->l_id - l_id >= (uint64_t) COUNTER_STRIPES * SESSIONS_PER_THREAD)
+    return -1;
+  return (int) (COUNTER_STRIPES - 1 - (loc_entry->l_id - l_id) / SESSIONS_PER_THREAD);
+}
+
+static inline void stripe_read_gathers_rep(loc_entry_t *loc_entry,
+                                           uint16_t stripe,
+                                           uint32_t log_no,
+                                           ts_tuple_t *ts,
+                                           uint8_t *value)
+{
+  stripe_read_t *stripe_read = &loc_entry->stripe_reads[stripe];
+  bool is_newer = stripe_read->replies == 0 || log_no > stripe_read->log_no ||
+                  (log_no == stripe_read->log_no && compare_ts(ts, &stripe_read->ts) == GREATER);
+  if (is_newer) {
+    stripe_read->log_no = log_no;
+    stripe_read->ts = *ts;
+    memcpy(&stripe_read->counter, value, sizeof(uint64_t));
+  }
+  stripe_read->replies++;
+  if (stripe_read->replies == QUORUM_NUM) {
+    loc_entry->stripes_read++;
+    if (loc_entry->stripes_read == COUNTER_STRIPES)
+      loc_entry->rmw_reps.ready_to_inspect = true;
+  }
+}
+
+// Arm the entry for the quorum reads of the stripes that have not gathered a quorum yet,
+// which start over from the committed state of the local stripe
+static inline void rearm_loc_entry_for_striped_read(loc_entry_t *loc_entry,
+                                                    uint16_t t_id)
+{
+  mica_op_t **stripes = loc_entry->stripe_kv_ptrs;
+  rearm_loc_entry_for_quorum_read(loc_entry, stripes[0], t_id);
+  for (uint16_t stripe = 1; stripe < COUNTER_STRIPES; stripe++)
+    advance_loc_entry_l_id(loc_entry, t_id);
+
+  for (uint16_t stripe = 0; stripe < COUNTER_STRIPES; stripe++) {
+    stripe_read_t *stripe_read = &loc_entry->stripe_reads[stripe];
+    if (stripe_read->replies >= QUORUM_NUM) continue;
+    memset(stripe_read, 0, sizeof(stripe_read_t));
+    lock_kv_ptr(stripes[stripe], t_id);
+    ts_tuple_t ts = stripes[stripe]->ts;
+    uint32_t log_no = stripes[stripe]->last_committed_log_no;
+    uint64_t counter;
+    memcpy(&counter, stripes[stripe]->value, sizeof(uint64_t));
+    unlock_kv_ptr(stripes[stripe], t_id);
+    stripe_read_gathers_rep(loc_entry, stripe, log_no, &ts, (uint8_t *) &counter);
+  }
+}
+
+// A read that must be linearized through Paxos re-arms its entry as an F&A of 0
+// that waits for the kv_ptr. It still completes to the client as a read
+static inline void rearm_loc_entry_as_zero_fetch_and_add(loc_entry_t* loc_entry,
+                                                         uint16_t t_id)
+{
+  loc_entry->opcode = FETCH_AND_ADD;
+  loc_entry->killable = false;
+  loc_entry->compare_val = read_zero_addend;
+  loc_entry->swap_val = read_zero_addend;
+  loc_entry->val_offset = 0;
+  loc_entry->all_aboard = false;
+  reset_loc_entry_for_new_rmw(loc_entry, t_id);
+  loc_entry->serves_read = true;
+  loc_entry->help_rmw->state = INVALID_RMW;
+  loc_entry->state = NEEDS_KV_PTR;
 }
 
 // When time-out-ing on a stuck Accepted value, and try to help it, you need to first propose your own
@@ -282,12 +782,13 @@ static inline bool does_rmw_fail_early(trace_op_t *op, mica_op_t *kv_ptr,
                                        uint16_t t_id)
 {
   if (ENABLE_ASSERTIONS) assert(op->real_val_len <= RMW_VALUE_SIZE);
+  uint8_t *kv_bytes = rmw_bytes_of_value(kv_ptr->value, op->val_offset);
   if (op->opcode == COMPARE_AND_SWAP_WEAK &&
       rmw_compare_fails(op->opcode, op->value_to_read,
-                        kv_ptr->value, op->real_val_len, t_id)) {
+                        kv_bytes, op->real_val_len, t_id)) {
     //my_printf(red, "CAS fails returns val %u/%u \n", kv_ptr->value[RMW_BYTE_OFFSET], op->value_to_read[0]);
 
-    fill_req_array_on_rmw_early_fail(op->session_id, kv_ptr->value,
+    fill_req_array_on_rmw_early_fail(op->session_id, kv_bytes,
                                      op->index_to_req_array, t_id);
     return true;
   }
@@ -300,15 +801,16 @@ static inline bool rmw_fails_with_loc_entry(loc_entry_t *loc_entry, mica_op_t *k
 {
   if (ENABLE_CAS_CANCELLING) {
     if (loc_entry->killable) {
+      uint8_t *kv_bytes = rmw_bytes_of_value(kv_ptr->value, loc_entry->val_offset);
       if (rmw_compare_fails(loc_entry->opcode, loc_entry->compare_val,
-                            kv_ptr->value, loc_entry->rmw_val_len, t_id)) {
+                            kv_bytes, loc_entry->rmw_val_len, t_id)) {
         (*rmw_fails) = true;
         if (ENABLE_ASSERTIONS) {
           assert(!loc_entry->rmw_is_successful);
           assert(loc_entry->rmw_val_len <= RMW_VALUE_SIZE);
           assert(loc_entry->helping_flag != HELPING);
         }
-        memcpy(loc_entry->value_to_read, kv_ptr->value,
+        memcpy(loc_entry->value_to_read, kv_bytes,
                loc_entry->rmw_val_len);
         return true;
       }
@@ -330,6 +832,110 @@ static inline void reinstate_loc_entry_after_helping(loc_entry_t *loc_entry, uin
 
 
 
+/*--------------------------------------------------------------------------
+ * --------------------ALL-ABOARD CONFLICT ESTIMATION-----------------------
+ * --------------------------------------------------------------------------*/
+
+static inline uint8_t *all_aboard_conflict_score(mica_op_t *kv_ptr,
+                                                 uint16_t t_id)
+{
+  return &all_aboard_conflicts[t_id][kv_ptr->key.bkt % ALL_ABOARD_BUCKETS];
+}
+
+// All-aboard needs every machine to ack its accepts: try it only
+// if the RMWs on the bucket of the key have recently gone through unopposed
+static inline bool all_aboard_is_likely_to_succeed(mica_op_t *kv_ptr,
+                                                   uint16_t t_id)
+{
+  if (!ADAPTIVE_ALL_ABOARD) return true;
+  return *all_aboard_conflict_score(kv_ptr, t_id) < ALL_ABOARD_CONFLICT_STEP;
+}
+
+static inline void record_rmw_contention(loc_entry_t *loc_entry,
+                                         uint16_t t_id)
+{
+  if (!ENABLE_ALL_ABOARD || !ADAPTIVE_ALL_ABOARD) return;
+  uint8_t *score = all_aboard_conflict_score(loc_entry->kv_ptr, t_id);
+  if (loc_entry->contended)
+    *score = (uint8_t) MIN(*score + ALL_ABOARD_CONFLICT_STEP, 2 * ALL_ABOARD_CONFLICT_STEP);
+  else if (*score > 0) (*score)--;
+}
+
+// To the client, the RMW operators are F&As that read back the whole pre-value,
+// while the F&A of 0 that linearizes a read is a read
+static inline uint8_t client_opcode_of_rmw(loc_entry_t *loc_entry)
+{
+  uint8_t opcode = loc_entry->opcode;
+  if (loc_entry->serves_read) return KVS_OP_GET;
+  return (uint8_t) (opcode_is_rmw_operator(opcode) ? FETCH_AND_ADD : opcode);
+}
+
+// The F&As that rode on the RMW complete with the prefix sums of the addends: they read the
+// value the owner read, with the prefix sum in the counter that the addends add to
+static inline void free_combined_rmws(loc_entry_t *loc_entry,
+                                      sess_stall_t *stall_info,
+                                      uint16_t t_id)
+{
+  if (ENABLE_ASSERTIONS) assert(loc_entry->rmw_is_successful);
+  uint64_t pre_value = *(uint64_t *) loc_entry->value_to_read + *(uint64_t *) loc_entry->compare_val;
+  loc_entry_t *combined = loc_entry->combined_next;
+  while (combined != NULL) {
+    if (ENABLE_ASSERTIONS) assert(combined->state == COMBINED);
+    memcpy(combined->value_to_read, loc_entry->value_to_read, loc_entry->rmw_val_len);
+    memcpy(combined->value_to_read, &pre_value, sizeof(uint64_t));
+    pre_value += *(uint64_t *) combined->compare_val;
+    combined->rmw_is_successful = true;
+    combined->state = INVALID_RMW;
+    fill_req_array_when_after_rmw(combined->sess_id, combined->index_to_req_array,
+                                  client_opcode_of_rmw(combined),
+                                  combined->value_to_read, true, t_id);
+    signal_completion_to_client(combined->sess_id, combined->index_to_req_array, t_id);
+    stall_info->stalled[combined->sess_id] = false;
+    loc_entry_t *next = combined->combined_next;
+    combined->combined_next = NULL;
+    combined = next;
+  }
+  loc_entry->combined_next = NULL;
+}
+
+// The queue moves to its first RMW, which becomes the owner
+static inline loc_entry_t *pass_handoff_queue_to_next(loc_entry_t *loc_entry)
+{
+  loc_entry_t *next = loc_entry->handoff_next;
+  if (ENABLE_ASSERTIONS) assert(next->state == HANDOFF_QUEUED);
+  next->handoff_tail = next->handoff_next == NULL ? NULL : loc_entry->handoff_tail;
+  loc_entry->handoff_next = NULL;
+  loc_entry->handoff_tail = NULL;
+  return next;
+}
+
+// The kv_ptr was not handed over: the first RMW of the queue goes back to grabbing it
+static inline void wake_handoff_queue(loc_entry_t *loc_entry)
+{
+  loc_entry_t *next = pass_handoff_queue_to_next(loc_entry);
+  next->state = NEEDS_KV_PTR;
+  next->back_off_cntr = 0;
+}
+
+// A quorum has accepted the RMW of the entry: the result is chosen and goes to the client now.
+// The session stays stalled, so that the entry is not reused before the commit acks free it
+static inline bool complete_rmw_at_accept_quorum(loc_entry_t *loc_entry,
+                                                 sess_stall_t *stall_info,
+                                                 uint16_t t_id)
+{
+  if (!EARLY_RMW_COMPLETION || READ_LEASES || loc_entry->helping_flag != NOT_HELPING) return false;
+  fill_req_array_when_after_rmw(loc_entry->sess_id, loc_entry->index_to_req_array,
+                                client_opcode_of_rmw(loc_entry),
+                                loc_entry->value_to_read, loc_entry->rmw_is_successful, t_id);
+  signal_completion_to_client(loc_entry->sess_id, loc_entry->index_to_req_array, t_id);
+  loc_entry->completed_early = true;
+  if (COMBINE_FETCH_AND_ADDS && loc_entry->combined_next != NULL) {
+    free_combined_rmws(loc_entry, stall_info, t_id);
+    stall_info->all_stalled = false;
+  }
+  return true;
+}
+
 // free a session held by an RMW
 static inline void free_session_from_rmw(loc_entry_t *loc_entry,
                                          sess_stall_t *stall_info,
@@ -337,13 +943,21 @@ static inline void free_session_from_rmw(loc_entry_t *loc_entry,
                                          uint16_t t_id)
 {
   check_free_session_from_rmw(loc_entry, stall_info, t_id);
-  fill_req_array_when_after_rmw(loc_entry->sess_id, loc_entry->index_to_req_array, loc_entry->opcode,
-                                loc_entry->value_to_read, loc_entry->rmw_is_successful, t_id);
+  record_rmw_contention(loc_entry, t_id);
+  if (!loc_entry->completed_early)
+    fill_req_array_when_after_rmw(loc_entry->sess_id, loc_entry->index_to_req_array,
+                                  client_opcode_of_rmw(loc_entry),
+                                  loc_entry->value_to_read, loc_entry->rmw_is_successful, t_id);
   if (VERIFY_PAXOS && allow_paxos_log) verify_paxos(loc_entry, t_id);
   // my_printf(cyan, "Session %u completing \n", loc_entry->glob_sess_id);
-  signal_completion_to_client(loc_entry->sess_id, loc_entry->index_to_req_array, t_id);
+  if (!loc_entry->completed_early)
+    signal_completion_to_client(loc_entry->sess_id, loc_entry->index_to_req_array, t_id);
   stall_info->stalled[loc_entry->sess_id] = false;
   stall_info->all_stalled = false;
+  if (COMBINE_FETCH_AND_ADDS && loc_entry->combined_next != NULL)
+    free_combined_rmws(loc_entry, stall_info, t_id);
+  if (HANDOFF_QUEUE && loc_entry->handoff_next != NULL)
+    wake_handoff_queue(loc_entry);
 }
 
 
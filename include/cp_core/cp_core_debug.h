@@ -247,6 +247,11 @@ static inline void check_when_init_loc_entry(loc_entry_t* loc_entry,
 {
   if (ENABLE_ASSERTIONS) {
     assert(op->real_val_len <= RMW_VALUE_SIZE);
+    if (PARTIAL_VALUE_RMWS) {
+      assert(op->val_offset + op->real_val_len <= RMW_VALUE_SIZE);
+      if (op->opcode == FETCH_AND_ADD)
+        assert(op->val_offset + sizeof(uint64_t) <= RMW_VALUE_SIZE);
+    }
     assert(!loc_entry->rmw_reps.ready_to_inspect);
     assert(loc_entry->rmw_reps.tot_replies == 0);
     assert(loc_entry->state == INVALID_RMW);
@@ -449,9 +454,9 @@ static inline void check_after_activate_kv_pair(mica_op_t *kv_ptr,
                                                 uint16_t t_id)
 {
   if (ENABLE_ASSERTIONS) {
-    if (committed_glob_sess_rmw_id[kv_ptr->rmw_id.id % GLOBAL_SESSION_NUM] >= kv_ptr->rmw_id.id) {
+    if (committed_glob_sess_rmw_id(kv_ptr->rmw_id.id % GLOBAL_SESSION_NUM) >= kv_ptr->rmw_id.id) {
       //my_printf(red, "Wrkr %u, attempts to activate with already committed RMW id %u/%u glob_sess id %u, state %u: %s \n",
-      //           t_id, kv_ptr->rmw_id.id, committed_glob_sess_rmw_id[kv_ptr->rmw_id.id % GLOBAL_SESSION_NUM],
+      //           t_id, kv_ptr->rmw_id.id, committed_glob_sess_rmw_id(kv_ptr->rmw_id.id % GLOBAL_SESSION_NUM),
       //           kv_ptr->rmw_id.id % GLOBAL_SESSION_NUM, state, message);
     }
     assert(state == PROPOSED || state == ACCEPTED);
@@ -587,15 +592,6 @@ static inline void check_state_before_commit_algorithm(mica_op_t *kv_ptr,
         }
       }
     }
-    else if (com_info->flag == FROM_REMOTE_COMMIT_NO_VAL) {
-      if (kv_ptr->last_committed_log_no < com_info->log_no) {
-        if (ENABLE_ASSERTIONS) {
-          assert(kv_ptr->state == ACCEPTED);
-          assert(kv_ptr->log_no == com_info->log_no);
-          assert(kv_ptr->accepted_rmw_id.id == com_info->rmw_id.id);
-        }
-      }
-    }
   }
 }
 
@@ -627,7 +623,7 @@ static inline void check_accept_snoops_entry(cp_acc_t *acc,
                                              mica_op_t *kv_ptr)
 {
   if (ENABLE_ASSERTIONS)  {
-    assert(acc->opcode == ACCEPT_OP);
+    assert(acc->opcode == ACCEPT_OP || acc->opcode == ACCEPT_RANGE_OP);
     assert(acc->log_no > kv_ptr->last_committed_log_no);
     assert(acc->log_no == kv_ptr->log_no);
     assert(check_entry_validity_with_key(&acc->key, kv_ptr));
@@ -720,21 +716,21 @@ static inline void check_registered_against_kv_ptr_last_committed(mica_op_t *kv_
 {
   if (ENABLE_ASSERTIONS) {
     uint32_t committed_glob_ses_id = (uint32_t)(committed_id % GLOBAL_SESSION_NUM);
-    MY_ASSERT(committed_id <= committed_glob_sess_rmw_id[committed_glob_ses_id],
+    MY_ASSERT(committed_id <= committed_glob_sess_rmw_id(committed_glob_ses_id),
               "After registering: rmw_id/registered %u/%u glob sess_id %u \n",
-              committed_id, committed_glob_sess_rmw_id[committed_glob_ses_id], committed_glob_ses_id);
+              committed_id, committed_glob_sess_rmw_id(committed_glob_ses_id), committed_glob_ses_id);
 
     uint32_t glob_sess_id = (uint32_t)(kv_ptr->last_committed_rmw_id.id % GLOBAL_SESSION_NUM);
     uint64_t id = kv_ptr->last_committed_rmw_id.id;
     assert(glob_sess_id < GLOBAL_SESSION_NUM);
-    if (committed_glob_sess_rmw_id[glob_sess_id] < id) {
+    if (committed_glob_sess_rmw_id(glob_sess_id) < id) {
       my_printf(yellow, "Committing %s rmw_id: %u glob_sess_id: %u \n", message, committed_id, committed_glob_ses_id);
       my_printf(red, "Wrkr %u: %s rmw_id: kv_ptr last committed %lu, "
                      "glob_sess_id :kv_ptr last committed %u,"
                      "committed_glob_sess_rmw_id %lu,   \n", t_id, message,
                 kv_ptr->last_committed_rmw_id.id,
                 glob_sess_id,
-                committed_glob_sess_rmw_id[glob_sess_id]);
+                committed_glob_sess_rmw_id(glob_sess_id));
       //assert(false);
     }
   }
@@ -840,11 +836,12 @@ static inline void check_find_local_and_handle_rmw_rep(loc_entry_t *loc_entry_ar
 {
   if (ENABLE_ASSERTIONS) {
     assert(loc_entry_array != NULL);
-    if (!opcode_is_rmw_rep(rep->opcode)) {
+    bool is_read_rep = !is_accept && rep->opcode == QUORUM_READ_REP;
+    if (!opcode_is_rmw_rep(rep->opcode) && !is_read_rep) {
       printf("Rep_i %u, current opcode %u first opcode: %u, byte_ptr %u \n",
              r_rep_i, rep->opcode, rep_mes->rmw_rep[0].opcode, byte_ptr);
     }
-    assert(opcode_is_rmw_rep(rep->opcode));
+    assert(opcode_is_rmw_rep(rep->opcode) || is_read_rep);
   }
   //my_printf(cyan, "RMW rep opcode %u, l_id %u \n", rep->opcode, rep->l_id);
 
@@ -1068,10 +1065,13 @@ static inline void check_kv_ptr_state_is_not_acced(mica_op_t *kv_ptr)
 }
 
 static inline void check_op_version(trace_op_t *op,
-                                    bool doing_all_aboard)
+                                    bool skips_proposes,
+                                    bool on_lease)
 {
   if (ENABLE_ASSERTIONS) {
-    if (doing_all_aboard)
+    if (on_lease)
+      assert(PROPOSER_LEASE_SLOTS > 0 && skips_proposes);
+    else if (skips_proposes)
       assert(op->ts.version == ALL_ABOARD_TS);
     else assert(op->ts.version == PAXOS_TS);
   }
@@ -1271,10 +1271,10 @@ static inline void check_when_rmw_has_committed(mica_op_t *kv_ptr,
                 t_id, glob_sess_id,
                 kv_ptr->last_committed_log_no, log_no,
                 kv_ptr->last_committed_rmw_id.id, rmw_id,
-                committed_glob_sess_rmw_id[glob_sess_id]);
+                committed_glob_sess_rmw_id(glob_sess_id));
 
     //for (uint64_t i = 0; i < GLOBAL_SESSION_NUM; i++)
-    //  printf("Glob sess num %lu: %lu \n", i, committed_glob_sess_rmw_id[i]);
+    //  printf("Glob sess num %lu: %lu \n", i, committed_glob_sess_rmw_id(i));
     assert(rep->opcode == RMW_ID_COMMITTED_SAME_LOG || RMW_ID_COMMITTED);
     assert(kv_ptr->last_committed_log_no > 0);
     if (rep->opcode == RMW_ID_COMMITTED_SAME_LOG) {
@@ -1486,7 +1486,7 @@ static inline void check_inputs_commit_algorithm(mica_op_t *kv_ptr,
 {
   if (ENABLE_ASSERTIONS) {
     assert(kv_ptr != NULL);
-    if (com_info->value == NULL) assert(com_info->no_value);
+    if (com_info->value == NULL) assert(com_info->no_value || com_info->delta != NULL);
     if (com_info->log_no == 0) {
       if (com_info->rmw_id.id != 0)
         error_mesage_on_commit_check(kv_ptr, com_info, "Rmw-id is zero but not log-no", t_id);
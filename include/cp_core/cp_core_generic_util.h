@@ -6,16 +6,26 @@
 #define CP_CORE_GENERIC_UTIL_H
 
 
+#include <time.h>
 #include <cp_config.h>
 #include <od_wrkr_side_calls.h>
 #include <od_generic_inline_util.h>
 #include <cp_core_structs.h>
+#include <cp_rmw_operators.h>
 
 
 /* ---------------------------------------------------------------------------
 //------------------------------ GENERIC UTILITY------------------------------------------
 //---------------------------------------------------------------------------*/
 
+// The monotonic clock that times read leases, RTTs and the tuners
+static inline uint64_t cp_clock_ns()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000 + (uint64_t) now.tv_nsec;
+}
+
 static inline const char* committing_flag_to_str(uint8_t state)
 {
   switch (state)
@@ -34,6 +44,10 @@ static inline const char* committing_flag_to_str(uint8_t state)
       return "FROM_REMOTE_COMMIT";
     case FROM_REMOTE_COMMIT_NO_VAL:
       return "FROM_REMOTE_COMMIT_NO_VAL";
+    case FROM_REMOTE_COMMIT_RANGE:
+      return "FROM_REMOTE_COMMIT_RANGE";
+    case FROM_REMOTE_COMMIT_DELTA:
+      return "FROM_REMOTE_COMMIT_DELTA";
     case FROM_LOCAL_ACQUIRE:
       return "FROM_LOCAL_ACQUIRE";
     case FROM_OOE_READ:
@@ -23,6 +23,7 @@ typedef struct mica_op mica_op_t;
 typedef struct cp_core_ctx cp_core_ctx_t;
 typedef struct trace_op trace_op_t;
 typedef struct sess_stall_info sess_stall_t;
+typedef struct rmw_local_entry loc_entry_t;
 
 void create_prop_rep(cp_prop_t *prop,
                      cp_prop_mes_t *prop_mes,
@@ -43,6 +44,12 @@ void create_acc_rep(cp_acc_t *acc,
 void act_on_quorum_of_commit_acks(cp_core_ctx_t *cp_core_ctx,
                                   uint16_t sess_id);
 
+// LAZY_COMMITS: commit the rmw that a propose or accept for log_no names as
+// committed in log_no - 1, if it is the one accepted in the kv_ptr -- the kv_ptr must be locked
+void commit_rmw_implied_by_next_log(mica_op_t *kv_ptr,
+                                    uint64_t prev_rmw_id,
+                                    uint32_t log_no,
+                                    uint16_t t_id);
 
 // Handle read replies that refer to RMWs (either replies to accepts or proposes)
 void handle_rmw_rep_replies(cp_core_ctx_t *cp_core_ctx,
@@ -52,6 +59,10 @@ void handle_rmw_rep_replies(cp_core_ctx_t *cp_core_ctx,
 
 
 
+// THRIFTY_QUORUMS: the round of the entry with l_id left the send fifo for the thrifty quorum only
+void cp_core_round_sent_to_thrifty_quorum(cp_core_ctx_t *cp_core_ctx,
+                                          uint64_t l_id);
+
 // Worker inspects its local RMW entries
 void cp_core_inspect_rmws(cp_core_ctx_t *cp_core_ctx);
 
@@ -67,6 +78,28 @@ void rmw_tries_to_get_kv_ptr_first_time(trace_op_t *op,
                                         uint16_t op_i,
                                         uint16_t t_id);
 
+// A read starts from the committed state of the local kv_ptr, which counts as the local reply
+void quorum_read_first_time(trace_op_t *op,
+                            mica_op_t *kv_ptr,
+                            cp_core_ctx_t *cp_core_ctx,
+                            uint16_t t_id);
+
+// STRIPED_COUNTERS: a read of a counter sends the quorum reads of all its stripes at once
+void striped_read_first_time(trace_op_t *op,
+                             mica_op_t *kv_ptr,
+                             cp_core_ctx_t *cp_core_ctx,
+                             uint16_t t_id);
+
+void send_counter_stripe_reads(cp_core_ctx_t *cp_core_ctx,
+                               loc_entry_t *loc_entry);
+
+// Reads under READ_LEASES: served locally by the lease holder, otherwise sent through the network
+void read_tries_read_lease_first_time(trace_op_t *op,
+                                      mica_op_t *kv_ptr,
+                                      cp_core_ctx_t *cp_core_ctx,
+                                      uint16_t op_i,
+                                      uint16_t t_id);
+
 void on_receiving_remote_commit(mica_op_t *kv_ptr,
                                 cp_com_t *com,
                                 cp_com_mes_t *com_mes,
@@ -16,6 +16,8 @@ typedef struct commit_info {
   rmw_id_t rmw_id;
   uint8_t *value;
   const char* message;
+  struct commit_range *range; // the earlier slots of a remote commit range must be registered too
+  struct commit_delta *delta; // the value must be rebuilt out of the operation of the RMW
 } commit_info_t;
 
 struct rmw_help_entry{
@@ -46,9 +48,18 @@ typedef struct rmw_rep_info {
   // used to know whether to help after a prop-- if you have seen a higher acc,
   // then you should not try to help a lower accept, and thus dont try at all
   uint32_t seen_higher_prop_version;
+  uint64_t read_lease_wait_ns; // READ_LEASES: the most ns left to a lease that nacked the accept
 
 } rmw_rep_info_t;
 
+// STRIPED_COUNTERS: the newest committed state of a stripe that the replies of its quorum read carry
+typedef struct stripe_read {
+  uint32_t log_no;
+  ts_tuple_t ts;
+  uint64_t counter;
+  uint8_t replies;
+} stripe_read_t;
+
 // Entry that keep pending thread-local RMWs, the entries are accessed with session id
 typedef struct rmw_local_entry {
   ts_tuple_t new_ts;
@@ -61,22 +72,51 @@ typedef struct rmw_local_entry {
   bool must_release;
   bool rmw_is_successful; // was the RMW (if CAS) successful
   bool all_aboard;
+  bool on_lease; // accepting with the proposer lease, without having proposed
+  bool contended; // the RMW has been nacked, has helped or has waited for the kv_ptr
   bool avoid_val_in_com;
+  bool ships_rmw_op; // SHIP_RMW_OPS_IN_COMMITS: the commit can carry the operation
+  bool full_val_in_accs; // an accept was nacked with LOG_TOO_HIGH: the next ones carry the whole value
   bool base_ts_found;
+  bool completed_early; // EARLY_RMW_COMPLETION: the client got the result at the accept quorum
+  bool serves_read; // an F&A of 0 that linearizes a read, which the client sees as a read
+  bool thrifty_sent; // THRIFTY_QUORUMS: the round in flight left for the thrifty quorum only
   uint8_t value_to_write[VALUE_SIZE];
   uint8_t value_to_read[VALUE_SIZE];
   ts_tuple_t base_ts;
   uint8_t *compare_val; //for CAS- add value for FAA
+  uint8_t *swap_val; // PARTIAL_VALUE_RMWS: the new bytes of a CAS or a write
   uint32_t rmw_val_len;
+  uint16_t val_offset; // PARTIAL_VALUE_RMWS: the RMW works on value[val_offset, val_offset + rmw_val_len)
   rmw_id_t rmw_id; // this is implicitly the l_id
   rmw_rep_info_t rmw_reps;
-  uint64_t epoch_id;
+  uint64_t epoch_id; // the read lease the entry's local accept promised, confirmed on its commit
   uint16_t sess_id;
   uint32_t glob_sess_id;
   uint32_t index_to_req_array;
   uint32_t back_off_cntr;
+  uint32_t retry_back_off; // inspections left before retrying with a bigger ts
+  uint64_t read_lease_wait_end; // READ_LEASES: no retry before this time, once a lease has nacked the accept
+  uint32_t back_off_rand; // xorshift state of the retry back-off jitter
+  uint16_t nacked_retries; // consecutive retries after nacks for higher ballots
+  uint8_t priority; // AGE_PRIORITY: the rounds the RMW has lost on its key
+  uint64_t combined_addend; // the sum of the addends of the F&As riding on the RMW
+  uint64_t rmw_operand; // SHIP_RMW_OPS_IN_COMMITS: the operand as applied on local accept
+#if LAZY_COMMITS
+  // the last commit the kv_ptr had when the entry took it, named in the proposes and accepts of the next log
+  uint64_t prev_committed_rmw_id;
+  uint32_t prev_committed_log_no;
+#endif
+  struct rmw_local_entry *combined_next; // the next F&A riding on the RMW of the owner
+  mica_op_t **stripe_kv_ptrs; // STRIPED_COUNTERS: the stripes of the counter a quorum read sums
+  stripe_read_t stripe_reads[COUNTER_STRIPES];
+  uint16_t stripes_read; // the stripes whose quorum read has gathered a quorum
+  uint16_t stripe; // the stripe whose quorum read is being filled
+  struct rmw_local_entry *handoff_next; // the next RMW queued for the kv_ptr
+  struct rmw_local_entry *handoff_tail; // owner only: the last RMW queued behind it
   uint16_t log_too_high_cntr;
   uint32_t all_aboard_time_out;
+  uint32_t thrifty_time_out;
   uint32_t log_no;
   uint32_t accepted_log_no; // this is the log no that has been accepted locally and thus when committed is guaranteed to be the correct logno
   uint64_t l_id; // the unique l_id of the entry, it typically coincides with the rmw_id except from helping cases
@@ -93,6 +133,12 @@ typedef struct cp_core_ctx {
   sess_stall_t *stall_info;
   void* appl_ctx;
   void* netw_ctx;
+#if LAZY_COMMITS
+  // copies of the committed RMWs whose commits have not been broadcast yet
+  loc_entry_t lazy_coms[LAZY_COMMIT_BATCH];
+  uint16_t lazy_com_num;
+  uint32_t lazy_com_wait; // inspections since the oldest deferred commit
+#endif
   uint16_t t_id;
 } cp_core_ctx_t;
 
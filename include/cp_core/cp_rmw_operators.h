@@ -0,0 +1,107 @@
+#ifndef CP_RMW_OPERATORS_H
+#define CP_RMW_OPERATORS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <cp_config.h>
+
+// An RMW operator is applied when the RMW is accepted locally: value holds the current value
+// and is updated in place with the operand. Return false to fail the RMW, leaving the value
+// unchanged; the client then reads back the current value, as with a failed CAS.
+// Add an operator by giving it the next opcode of the range in cp_opcodes.h and an entry below
+typedef bool (*rmw_operator_t)(uint8_t *value, const uint8_t *operand, uint32_t val_len);
+
+static inline bool opcode_is_rmw_operator(uint8_t opcode)
+{
+  return opcode >= RMW_OPERATOR_BASE && opcode < RMW_OPERATOR_BASE + RMW_OPERATOR_NUM;
+}
+
+// Max, min and bounded decrement work on the first 8 bytes of the value as an unsigned counter,
+// and fail on a shorter value
+static inline bool rmw_op_max(uint8_t *value, const uint8_t *operand, uint32_t val_len)
+{
+  uint64_t counter, arg;
+  if (val_len < sizeof(uint64_t)) return false;
+  memcpy(&counter, value, sizeof(uint64_t));
+  memcpy(&arg, operand, sizeof(uint64_t));
+  if (arg <= counter) return false;
+  memcpy(value, &arg, sizeof(uint64_t));
+  return true;
+}
+
+static inline bool rmw_op_min(uint8_t *value, const uint8_t *operand, uint32_t val_len)
+{
+  uint64_t counter, arg;
+  if (val_len < sizeof(uint64_t)) return false;
+  memcpy(&counter, value, sizeof(uint64_t));
+  memcpy(&arg, operand, sizeof(uint64_t));
+  if (arg >= counter) return false;
+  memcpy(value, &arg, sizeof(uint64_t));
+  return true;
+}
+
+// Fails instead of going below zero
+static inline bool rmw_op_bounded_dec(uint8_t *value, const uint8_t *operand, uint32_t val_len)
+{
+  uint64_t counter, arg;
+  if (val_len < sizeof(uint64_t)) return false;
+  memcpy(&counter, value, sizeof(uint64_t));
+  memcpy(&arg, operand, sizeof(uint64_t));
+  if (arg > counter) return false;
+  counter -= arg;
+  memcpy(value, &counter, sizeof(uint64_t));
+  return true;
+}
+
+static inline bool rmw_op_bit_or(uint8_t *value, const uint8_t *operand, uint32_t val_len)
+{
+  for (uint32_t i = 0; i < val_len; i++)
+    value[i] |= operand[i];
+  return true;
+}
+
+// The value is a list of 8-byte items whose first lane counts the items;
+// the first 8 bytes of the operand are appended, and a full list fails the append
+static inline bool rmw_op_append(uint8_t *value, const uint8_t *operand, uint32_t val_len)
+{
+  uint64_t items;
+  uint64_t capacity = val_len / sizeof(uint64_t);
+  if (capacity == 0) return false;
+  memcpy(&items, value, sizeof(uint64_t));
+  if (items + 1 >= capacity) return false;
+  items++;
+  memcpy(value, &items, sizeof(uint64_t));
+  memcpy(value + items * sizeof(uint64_t), operand, sizeof(uint64_t));
+  return true;
+}
+
+static const rmw_operator_t rmw_operators[RMW_OPERATOR_NUM] = {
+  [RMW_OP_MAX - RMW_OPERATOR_BASE] = rmw_op_max,
+  [RMW_OP_MIN - RMW_OPERATOR_BASE] = rmw_op_min,
+  [RMW_OP_BIT_OR - RMW_OPERATOR_BASE] = rmw_op_bit_or,
+  [RMW_OP_BOUNDED_DEC - RMW_OPERATOR_BASE] = rmw_op_bounded_dec,
+  [RMW_OP_APPEND - RMW_OPERATOR_BASE] = rmw_op_append,
+};
+
+// Rebuild the value of a shipped F&A or RMW operator on the value it was applied on;
+// a shipped plain write carries the bytes the RMW left behind
+static inline bool apply_shipped_rmw_op(uint8_t rmw_opcode, uint8_t *value,
+                                        const uint8_t *operand, uint32_t val_len)
+{
+  if (rmw_opcode == RMW_PLAIN_WRITE) {
+    memcpy(value, operand, val_len);
+    return true;
+  }
+  if (rmw_opcode == FETCH_AND_ADD) {
+    uint64_t counter, addend;
+    memcpy(&counter, value, sizeof(uint64_t));
+    memcpy(&addend, operand, sizeof(uint64_t));
+    counter += addend;
+    memcpy(value, &counter, sizeof(uint64_t));
+    return true;
+  }
+  return rmw_operators[rmw_opcode - RMW_OPERATOR_BASE](value, operand, val_len);
+}
+
+#endif //CP_RMW_OPERATORS_H
@@ -17,6 +17,10 @@ void cp_KVS_batch_op_trace(uint16_t op_num,
                            cp_ctx_t *cp_ctx,
                            uint16_t t_id);
 
+// STRIPED_COUNTERS: the stripes of the counters do not move in the KVS, so they are located once,
+// and the sessions whose keys are stripes are moved to other keys
+void cp_KVS_locate_counter_stripes(cp_ctx_t *cp_ctx);
+
 void cp_KVS_batch_op_props(context_t *ctx);
 void cp_KVS_batch_op_accs(context_t *ctx);
 void cp_KVS_batch_op_coms(context_t *ctx);
@@ -58,11 +58,11 @@ static inline void check_received_rmw_in_KVS(void **ops,
   if (ENABLE_ASSERTIONS) {
     if (is_accept) {
       cp_acc_t **accs = (cp_acc_t **) ops;
-      assert(accs[op_i]->opcode == ACCEPT_OP);
+      assert(accs[op_i]->opcode == ACCEPT_OP || accs[op_i]->opcode == ACCEPT_RANGE_OP);
     }
     else {
       cp_prop_t **props = (cp_prop_t **) ops;
-      assert(props[op_i]->opcode == PROPOSE_OP);
+      assert(props[op_i]->opcode == PROPOSE_OP || props[op_i]->opcode == QUORUM_READ_OP);
     }
   }
 }
@@ -75,9 +75,10 @@ static inline void check_trace_req(cp_ctx_t *cp_ctx, trace_t *trace, trace_op_t
 {
   if (ENABLE_ASSERTIONS) {
     assert(trace->opcode != NOP);
-    check_state_with_allowed_flags(8, trace->opcode, OP_RELEASE, KVS_OP_PUT,
-                                   OP_ACQUIRE, KVS_OP_GET, FETCH_AND_ADD, COMPARE_AND_SWAP_WEAK,
-                                   COMPARE_AND_SWAP_STRONG);
+    if (!opcode_is_rmw_operator(trace->opcode))
+      check_state_with_allowed_flags(8, trace->opcode, OP_RELEASE, KVS_OP_PUT,
+                                     OP_ACQUIRE, KVS_OP_GET, FETCH_AND_ADD, COMPARE_AND_SWAP_WEAK,
+                                     COMPARE_AND_SWAP_STRONG);
     assert(op->opcode == trace->opcode);
     assert(!cp_ctx->stall_info.stalled[working_session]);
   }
@@ -382,7 +383,8 @@ static inline void check_when_filling_op(cp_ctx_t *cp_ctx,
                                          int working_session,
                                          bool is_rmw)
 {
-  if (ENABLE_ASSERTIONS) assert(is_rmw);
+  if (ENABLE_ASSERTIONS) assert(is_rmw || ((ENABLE_QUORUM_READS || READ_LEASES || STRIPED_COUNTERS) &&
+                                          op->opcode == KVS_OP_GET));
   if (ENABLE_ASSERTIONS && !ENABLE_CLIENTS && op->opcode == FETCH_AND_ADD) {
     assert(is_rmw);
     assert(op->value_to_write == op->value);
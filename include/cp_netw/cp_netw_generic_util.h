@@ -11,6 +11,7 @@
 #include <od_generic_inline_util.h>
 #include <cp_netw_structs.h>
 #include <cp_messages.h>
+#include <cp_rmw_operators.h>
 
 
 
@@ -31,7 +32,8 @@ static inline bool cas_a_state(atomic_uint_fast8_t * state, uint8_t old_state, u
 static inline bool opcode_is_rmw(uint8_t opcode)
 {
   return opcode == FETCH_AND_ADD || opcode == COMPARE_AND_SWAP_WEAK ||
-         opcode == COMPARE_AND_SWAP_STRONG || opcode == RMW_PLAIN_WRITE;
+         opcode == COMPARE_AND_SWAP_STRONG || opcode == RMW_PLAIN_WRITE ||
+         opcode_is_rmw_operator(opcode);
 }
 
 
@@ -57,6 +59,8 @@ static inline uint16_t get_write_size_from_opcode(uint8_t opcode) {
       return COM_SIZE;
     case COMMIT_OP_NO_VAL:
       return COMMIT_NO_VAL_SIZE;
+    case COMMIT_DELTA_OP:
+      return COM_DELTA_SIZE;
     default: if (ENABLE_ASSERTIONS) assert(false);
   }
 }
@@ -26,6 +26,9 @@ bool cp_com_insert(void *ctx,
                    void *loc_entry,
                    uint32_t state);
 
+// Send proposes and accepts to all machines for a while, instead of the thrifty quorum
+void cp_widen_quorum(void *ctx);
+
 
 
 #endif //ODYSSEY_CP_NETW_INTERFACE_H
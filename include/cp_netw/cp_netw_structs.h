@@ -5,6 +5,8 @@
 #ifndef ODYSSEY_CP_NETW_STRUCTS_H
 #define ODYSSEY_CP_NETW_STRUCTS_H
 
+#include <cp_config.h>
+
 
 typedef struct cp_core_ctx cp_core_ctx_t;
 typedef struct trace_op trace_op_t;
@@ -37,6 +39,42 @@ struct l_ids {
   uint64_t applied_com_id;
 };
 
+// Remembers when each prop/acc message was sent, to time the replies per peer
+#define RTT_SLOTS (2 * MAX(PROP_CREDITS, ACC_CREDITS))
+typedef struct cp_rtt_slot {
+  uint64_t l_id; // the message whose send time the slot holds
+  uint64_t sent_ns;
+} cp_rtt_slot_t;
+
+typedef struct cp_rtt {
+  bool enabled;
+  cp_rtt_slot_t prop_sent[RTT_SLOTS];
+  cp_rtt_slot_t acc_sent[RTT_SLOTS];
+  uint64_t rtt_ns[MACHINE_NUM]; // EWMA
+  uint64_t samples[MACHINE_NUM];
+  uint64_t last_rep_ns[MACHINE_NUM];
+} cp_rtt_t;
+
+// The remote machines proposes and accepts are sent to, when not sending to all of them
+typedef struct cp_thrifty {
+  uint64_t widened_since_ns;
+  uint64_t widened_until_ns;
+  uint8_t quorum_ids[REMOTE_QUORUM];
+  bool in_quorum[MACHINE_NUM];
+  bool narrowed; // the last broadcast went to the quorum only
+} cp_thrifty_t;
+
+// Caps the credits of the broadcast qps below the compile-time maxima.
+// Lowering a cap with credits in flight is paid back as a debt:
+// the next credits returned by that machine are swallowed
+typedef struct cp_credit_tuner {
+  bool calibrating;
+  uint64_t start_ns;
+  uint64_t mes_sent[QP_NUM];
+  uint16_t credit_cap[QP_NUM];
+  uint16_t credit_debt[QP_NUM][MACHINE_NUM];
+} cp_credit_tuner_t;
+
 typedef struct cp_cp_ctx_debug {
   bool slept;
   uint64_t loop_counter;
@@ -48,6 +86,10 @@ typedef struct cp_cp_ctx_debug {
 
 
 
+typedef struct cp_send_sched {
+  uint32_t deferred_prop_loops; // consecutive loops proposes have been held back
+} cp_send_sched_t;
+
 typedef struct cp_ctx {
   fifo_t *com_rob;
   cp_ptrs_to_ops_t *ptrs_to_ops;
@@ -58,6 +100,12 @@ typedef struct cp_ctx {
   struct l_ids l_ids;
   cp_debug_t *debug_loop;
   mica_key_t *key_per_sess;
+  mica_op_t **counter_stripes; // STRIPED_COUNTERS: the kv_ptrs of the stripes, COUNTER_STRIPES per counter
+  struct commit *last_com; // last entry of the commit message being filled, a candidate to be extended into a range
+  cp_rtt_t rtt;
+  cp_credit_tuner_t tuner;
+  cp_send_sched_t sched;
+  cp_thrifty_t thrifty;
 } cp_ctx_t;
 
 // A helper to debug sessions by remembering which write holds a given session
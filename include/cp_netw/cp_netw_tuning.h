@@ -0,0 +1,335 @@
+#ifndef ODYSSEY_CP_NETW_TUNING_H
+#define ODYSSEY_CP_NETW_TUNING_H
+
+#include <cp_netw_generic_util.h>
+#include <cp_core_generic_util.h>
+#include "od_network_context.h"
+#include <cp_stats.h>
+
+/* ---------------------------------------------------------------------------
+//------------------------------ PEER RTT ------------------------------------
+//---------------------------------------------------------------------------*/
+
+static inline void cp_rtt_mark_sent(cp_rtt_t *rtt,
+                                    uint64_t l_id,
+                                    bool is_accept)
+{
+  if (!rtt->enabled) return;
+  cp_rtt_slot_t *slot = &(is_accept ? rtt->acc_sent : rtt->prop_sent)[l_id % RTT_SLOTS];
+  slot->l_id = l_id;
+  slot->sent_ns = cp_clock_ns();
+}
+
+static inline void cp_rtt_on_rep(cp_rtt_t *rtt,
+                                 cp_rmw_rep_mes_t *rep_mes,
+                                 bool is_accept)
+{
+  if (!rtt->enabled) return;
+  cp_rtt_slot_t *slot = &(is_accept ? rtt->acc_sent : rtt->prop_sent)[rep_mes->l_id % RTT_SLOTS];
+  // the slot has been reused by a newer message, or was never filled
+  if (slot->l_id != rep_mes->l_id || slot->sent_ns == 0) return;
+  uint64_t now = cp_clock_ns();
+  uint64_t sample = now - slot->sent_ns;
+  uint8_t m_id = rep_mes->m_id;
+  rtt->last_rep_ns[m_id] = now;
+  if (rtt->samples[m_id] == 0) rtt->rtt_ns[m_id] = sample;
+  else rtt->rtt_ns[m_id] += (sample >> RTT_EWMA_SHIFT) - (rtt->rtt_ns[m_id] >> RTT_EWMA_SHIFT);
+  rtt->samples[m_id]++;
+}
+
+/* ---------------------------------------------------------------------------
+//------------------------------ THRIFTY QUORUMS -----------------------------
+//---------------------------------------------------------------------------*/
+
+// Everyone that replies while widened becomes a candidate for the quorum again
+static inline void cp_widen_thrifty_quorum(cp_ctx_t *cp_ctx)
+{
+  uint64_t now = cp_clock_ns();
+  cp_thrifty_t *thrifty = &cp_ctx->thrifty;
+  if (now >= thrifty->widened_until_ns) thrifty->widened_since_ns = now;
+  thrifty->widened_until_ns = now + THRIFTY_WIDEN_NS;
+}
+
+// Pick the REMOTE_QUORUM machines with the lowest rtt, out of those that have replied
+// since the last widening; returns false if there are not enough of them
+static inline bool cp_pick_thrifty_quorum(context_t *ctx)
+{
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  cp_rtt_t *rtt = &cp_ctx->rtt;
+  cp_thrifty_t *thrifty = &cp_ctx->thrifty;
+  uint8_t picked = 0;
+  for (uint8_t m_i = 0; m_i < MACHINE_NUM; m_i++) {
+    thrifty->in_quorum[m_i] = false;
+    if (m_i == ctx->m_id || rtt->samples[m_i] == 0 ||
+        rtt->last_rep_ns[m_i] < thrifty->widened_since_ns) continue;
+    uint8_t pos = picked;
+    while (pos > 0 && rtt->rtt_ns[thrifty->quorum_ids[pos - 1]] > rtt->rtt_ns[m_i]) pos--;
+    if (pos >= REMOTE_QUORUM) continue;
+    for (uint8_t i = (uint8_t) MIN(picked, REMOTE_QUORUM - 1); i > pos; i--)
+      thrifty->quorum_ids[i] = thrifty->quorum_ids[i - 1];
+    thrifty->quorum_ids[pos] = m_i;
+    if (picked < REMOTE_QUORUM) picked++;
+  }
+  if (picked < REMOTE_QUORUM) return false;
+  for (uint8_t i = 0; i < REMOTE_QUORUM; i++)
+    thrifty->in_quorum[thrifty->quorum_ids[i]] = true;
+  return true;
+}
+
+// Whether the broadcasts of the qp go to m_id
+static inline bool cp_bcast_reaches(context_t *ctx,
+                                    uint16_t qp_id,
+                                    uint8_t m_id)
+{
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  if (!THRIFTY_QUORUMS || qp_id == COM_QP_ID || !cp_ctx->thrifty.narrowed) return true;
+  return cp_ctx->thrifty.in_quorum[m_id];
+}
+
+// Odyssey broadcasts to, and checks the credits of, the active machines of the q_info:
+// proposes and accepts go out with the q_info narrowed to the thrifty quorum
+static inline void cp_send_to_thrifty_quorum(context_t *ctx,
+                                             uint16_t qp_id)
+{
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  cp_thrifty_t *thrifty = &cp_ctx->thrifty;
+  thrifty->narrowed = cp_clock_ns() >= thrifty->widened_until_ns &&
+                      cp_pick_thrifty_quorum(ctx);
+  if (!thrifty->narrowed) {
+    ctx_send_broadcasts(ctx, qp_id);
+    return;
+  }
+
+  quorum_info_t *q_info = ctx->q_info;
+  quorum_info_t all_machines = *q_info;
+  q_info->active_num = 0;
+  q_info->missing_num = 0;
+  for (uint8_t m_i = 0; m_i < MACHINE_NUM; m_i++) {
+    if (m_i == ctx->m_id) continue;
+    if (thrifty->in_quorum[m_i]) q_info->active_ids[q_info->active_num++] = m_i;
+    else q_info->missing_ids[q_info->missing_num++] = m_i;
+  }
+  ctx_send_broadcasts(ctx, qp_id);
+  *q_info = all_machines;
+  if (ENABLE_STAT_COUNTING) cp_t_stats[ctx->t_id].thrifty_sends++;
+}
+
+/* ---------------------------------------------------------------------------
+//------------------------------ CREDIT CAPS ---------------------------------
+//---------------------------------------------------------------------------*/
+
+static inline void cp_init_credit_caps(cp_credit_tuner_t *tuner)
+{
+  tuner->credit_cap[PROP_QP_ID] = cp_params.prop_credits;
+  tuner->credit_cap[ACC_QP_ID] = cp_params.acc_credits;
+  tuner->credit_cap[COM_QP_ID] = cp_params.com_credits;
+}
+
+// A machine has returned some credits: pay back any debt before making them usable
+static inline void cp_return_credits(context_t *ctx,
+                                     uint16_t qp_id,
+                                     uint8_t m_id,
+                                     uint16_t returned)
+{
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  uint16_t *debt = &cp_ctx->tuner.credit_debt[qp_id][m_id];
+  uint16_t absorbed = MIN(*debt, returned);
+  *debt -= absorbed;
+  ctx->qp_meta[qp_id].credits[m_id] += returned - absorbed;
+}
+
+// The qp_meta credits have already been incremented by odyssey (i.e. acks):
+// take back what is owed
+static inline void cp_absorb_credit_debt(context_t *ctx,
+                                         uint16_t qp_id,
+                                         uint8_t m_id,
+                                         uint16_t returned)
+{
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  uint16_t *debt = &cp_ctx->tuner.credit_debt[qp_id][m_id];
+  uint16_t absorbed = MIN(*debt, returned);
+  *debt -= absorbed;
+  ctx->qp_meta[qp_id].credits[m_id] -= absorbed;
+}
+
+static inline uint16_t cp_max_credits(uint16_t qp_id)
+{
+  switch (qp_id) {
+    case PROP_QP_ID: return PROP_CREDITS;
+    case ACC_QP_ID: return ACC_CREDITS;
+    case COM_QP_ID: return COM_CREDITS;
+    default: if (ENABLE_ASSERTIONS) assert(false);
+  }
+  return 0;
+}
+
+// The number of broadcasts a quorum of the remote machines can take right now
+static inline uint16_t cp_quorum_credits(context_t *ctx,
+                                         uint16_t qp_id)
+{
+  uint16_t *credits = ctx->qp_meta[qp_id].credits;
+  uint16_t sorted[REM_MACH_NUM];
+  uint8_t rm_i = 0;
+  for (uint8_t m_i = 0; m_i < MACHINE_NUM; m_i++) {
+    if (m_i == ctx->m_id) continue;
+    uint8_t pos = rm_i++;
+    while (pos > 0 && sorted[pos - 1] < credits[m_i]) {
+      sorted[pos] = sorted[pos - 1];
+      pos--;
+    }
+    sorted[pos] = credits[m_i];
+  }
+  return sorted[REMOTE_QUORUM - 1];
+}
+
+// Broadcasts need credits towards every machine: top up the machines that lag behind
+// a quorum with credits borrowed from the headroom between the runtime and the
+// compile-time credits, which sizes their receive buffers. Borrowed credits are
+// recorded as debt, and paid back from the credits the laggard returns.
+// Thrifty proposes and accepts do not wait for laggards in the first place
+static inline void cp_lend_credits_to_laggards(context_t *ctx,
+                                               uint16_t qp_id)
+{
+  if (!QUORUM_CREDIT_BCASTS) return;
+  if (THRIFTY_QUORUMS && qp_id != COM_QP_ID) return;
+  per_qp_meta_t *qp_meta = &ctx->qp_meta[qp_id];
+  if (qp_meta->send_fifo->capacity == 0) return;
+
+  uint16_t quorum_credits = cp_quorum_credits(ctx, qp_id);
+  if (quorum_credits == 0) return;
+
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  cp_credit_tuner_t *tuner = &cp_ctx->tuner;
+  for (uint8_t m_i = 0; m_i < MACHINE_NUM; m_i++) {
+    if (m_i == ctx->m_id) continue;
+    uint16_t *credits = &qp_meta->credits[m_i];
+    if (*credits >= quorum_credits) continue;
+    uint16_t *debt = &tuner->credit_debt[qp_id][m_i];
+    uint16_t in_use = tuner->credit_cap[qp_id] + *debt;
+    uint16_t max_credits = cp_max_credits(qp_id);
+    if (in_use >= max_credits) continue;
+    uint16_t lent = MIN(quorum_credits - *credits, max_credits - in_use);
+    *credits += lent;
+    *debt += lent;
+    if (ENABLE_STAT_COUNTING) cp_t_stats[ctx->t_id].lent_credits += lent;
+  }
+}
+
+static inline void cp_set_credit_cap(context_t *ctx,
+                                     uint16_t qp_id,
+                                     uint16_t new_cap)
+{
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  cp_credit_tuner_t *tuner = &cp_ctx->tuner;
+  uint16_t old_cap = tuner->credit_cap[qp_id];
+  uint16_t *credits = ctx->qp_meta[qp_id].credits;
+
+  for (uint8_t m_i = 0; m_i < MACHINE_NUM; m_i++) {
+    if (m_i == ctx->m_id) continue;
+    uint16_t *debt = &tuner->credit_debt[qp_id][m_i];
+    if (new_cap < old_cap) {
+      uint16_t diff = old_cap - new_cap;
+      uint16_t take = MIN(diff, credits[m_i]);
+      credits[m_i] -= take;
+      *debt += diff - take;
+    }
+    else {
+      uint16_t diff = new_cap - old_cap;
+      uint16_t forgiven = MIN(diff, *debt);
+      *debt -= forgiven;
+      credits[m_i] += diff - forgiven;
+    }
+  }
+  tuner->credit_cap[qp_id] = new_cap;
+}
+
+/* ---------------------------------------------------------------------------
+//------------------------------ CALIBRATION ---------------------------------
+//---------------------------------------------------------------------------*/
+
+static inline void cp_start_credit_calibration(context_t *ctx)
+{
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  cp_init_credit_caps(&cp_ctx->tuner);
+  if (THRIFTY_QUORUMS) {
+    cp_ctx->rtt.enabled = true;
+    cp_widen_thrifty_quorum(cp_ctx); // measure all machines first
+  }
+  if (!cp_params.auto_tune_credits) return;
+  cp_ctx->rtt.enabled = true;
+  cp_ctx->tuner.calibrating = true;
+  cp_ctx->tuner.start_ns = cp_clock_ns();
+}
+
+static inline void cp_count_sent_for_calibration(context_t *ctx,
+                                                 uint16_t qp_id)
+{
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  if (cp_ctx->tuner.calibrating)
+    cp_ctx->tuner.mes_sent[qp_id]++;
+}
+
+static inline uint64_t cp_mean_peer_rtt(context_t *ctx,
+                                        uint64_t *min_samples)
+{
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  uint64_t rtt_sum = 0;
+  *min_samples = UINT64_MAX;
+  for (uint8_t m_i = 0; m_i < MACHINE_NUM; m_i++) {
+    if (m_i == ctx->m_id) continue;
+    rtt_sum += cp_ctx->rtt.rtt_ns[m_i];
+    *min_samples = MIN(*min_samples, cp_ctx->rtt.samples[m_i]);
+  }
+  return rtt_sum / REM_MACH_NUM;
+}
+
+// Credits that cover the bandwidth-delay product of a qp: messages sent per ns times the rtt
+static inline uint16_t cp_credits_for_bdp(uint64_t mes_sent,
+                                          uint64_t elapsed_ns,
+                                          uint64_t rtt_ns,
+                                          uint16_t max_credits)
+{
+  uint64_t in_flight = ((mes_sent * rtt_ns) + elapsed_ns - 1) / elapsed_ns;
+  return (uint16_t) MAX(1, MIN(in_flight + 1, max_credits));
+}
+
+static inline void cp_finish_credit_calibration(context_t *ctx,
+                                                uint64_t elapsed_ns,
+                                                uint64_t rtt_ns)
+{
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  cp_credit_tuner_t *tuner = &cp_ctx->tuner;
+  cp_set_credit_cap(ctx, PROP_QP_ID,
+                    cp_credits_for_bdp(tuner->mes_sent[PROP_QP_ID], elapsed_ns, rtt_ns,
+                                       PROP_CREDITS - LAGGARD_HEADROOM));
+  cp_set_credit_cap(ctx, ACC_QP_ID,
+                    cp_credits_for_bdp(tuner->mes_sent[ACC_QP_ID], elapsed_ns, rtt_ns,
+                                       ACC_CREDITS - LAGGARD_HEADROOM));
+  cp_set_credit_cap(ctx, COM_QP_ID,
+                    cp_credits_for_bdp(tuner->mes_sent[COM_QP_ID], elapsed_ns, rtt_ns,
+                                       COM_CREDITS - LAGGARD_HEADROOM));
+  tuner->calibrating = false;
+  cp_ctx->rtt.enabled = THRIFTY_QUORUMS;
+  if (ctx->t_id == 0)
+    my_printf(green, "Wrkr %u calibrated credits: rtt %lu ns, props %u, accs %u, coms %u \n",
+              ctx->t_id, rtt_ns, tuner->credit_cap[PROP_QP_ID],
+              tuner->credit_cap[ACC_QP_ID], tuner->credit_cap[COM_QP_ID]);
+}
+
+// Called every loop: once enough time and rtt samples are gathered, size the credits
+static inline void cp_credit_calibration_step(context_t *ctx)
+{
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  if (!cp_ctx->tuner.calibrating) return;
+
+  uint64_t elapsed_ns = cp_clock_ns() - cp_ctx->tuner.start_ns;
+  if (elapsed_ns < CREDIT_CALIBRATION_TIME_NS) return;
+
+  uint64_t min_samples;
+  uint64_t rtt_ns = cp_mean_peer_rtt(ctx, &min_samples);
+  if (min_samples < CREDIT_CALIBRATION_MIN_SAMPLES) return;
+
+  cp_finish_credit_calibration(ctx, elapsed_ns, rtt_ns);
+}
+
+#endif //ODYSSEY_CP_NETW_TUNING_H
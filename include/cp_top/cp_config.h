@@ -20,6 +20,8 @@ void cp_stats(stats_ctx_t *ctx);
 
 
 // CORE CONFIGURATION
+// Credits and coalescing are compile-time maxima: all buffers are sized on them.
+// The values actually used are in cp_params and can be lowered from the command line
 #define PROP_CREDITS 8//
 #define ACC_CREDITS 8
 #define PROP_COALESCE 8
@@ -36,15 +38,119 @@ void cp_stats(stats_ctx_t *ctx);
 // Important Knobs
 
 #define ENABLE_COMMITS_WITH_NO_VAL 1
+#define ENABLE_COMMIT_RANGES 0 // fold commits of consecutive log slots of a key into one entry
 #define ENABLE_CAS_CANCELLING 1
+#define PAD_COMMITTED_RMW_IDS 0 // one cache line per global session in the registry of committed rmw-ids
 #define ENABLE_ALL_ABOARD 0
+// Pick All-aboard per RMW, only on keys where the recent RMWs met no conflicts: each worker
+// hashes keys into ALL_ABOARD_BUCKETS estimators, and a conflict keeps a bucket on
+// Classic Paxos for ALL_ABOARD_CONFLICT_STEP conflict-free RMWs
+#define ADAPTIVE_ALL_ABOARD ENABLE_ALL_ABOARD // only consulted when All-aboard is on
+#define ALL_ABOARD_BUCKETS 4096
+#define ALL_ABOARD_CONFLICT_STEP 8
+// Send commits, then accepts, then proposes; hold proposes back while
+// commits or accepts are out of credits, for at most PROP_STARVATION_LIMIT loops
+#define PRIORITY_SEND_SCHEDULING 0
+#define PROP_STARVATION_LIMIT 64
+// Broadcast as soon as a quorum of the remote machines has credits: machines that lag behind
+// are lent credits out of a headroom of LAGGARD_CREDITS that is kept below the compile-time credits
+#define QUORUM_CREDIT_BCASTS 0
+#define LAGGARD_CREDITS 2
+#define LAGGARD_HEADROOM (QUORUM_CREDIT_BCASTS ? LAGGARD_CREDITS : 0)
+// A proposer whose ballot was promised by a quorum keeps it for the next
+// PROPOSER_LEASE_SLOTS log numbers of the key and sends accepts for them directly
+#define PROPOSER_LEASE_SLOTS 0
+// Send proposes and accepts only to the REMOTE_QUORUM remote machines with the lowest rtt.
+// A nacked round, or one that gathers no quorum of replies within THRIFTY_TIMEOUT_CNT
+// inspections, sends to all machines for the next THRIFTY_WIDEN_NS. Excludes All-aboard
+#define THRIFTY_QUORUMS 0
+#define THRIFTY_WIDEN_NS (1000 * 1000) // 1 ms
+// Reads (KVS_OP_GET) ask a quorum for the committed state of the key, and complete in one round trip
+// if the quorum agrees and has no newer accepted value; otherwise they are performed as an F&A of 0
+#define ENABLE_QUORUM_READS 0
+// The designated replica of a key (key.bkt % MACHINE_NUM) serves its reads from the kv_ptr, with no
+// messages, while it holds a read lease: every ack to one of its accepts or reply to one of its quorum
+// reads promises it READ_LEASE_NS in which the acceptor nacks the accepts of other machines for the key,
+// which back off until the promise runs out. The lease is confirmed when the RMW of the accept commits
+// locally or the quorum read is decided, and is given up READ_LEASE_GUARD_NS early to absorb clock drift
+#define READ_LEASES 0
+#define READ_LEASE_NS (2 * 1000 * 1000) // 2 ms
+#define READ_LEASE_GUARD_NS (READ_LEASE_NS / 8)
+#define READ_LEASE_CONFIRMED 1 // low bit of mica_op_t.epoch_id
+// After a nack for a higher ballot, wait a random number of inspections, below
+// min(cap, base << consecutive nacked retries), before retrying with a bigger ts.
+// The values actually used are in cp_params and can be set from the command line, up to RETRY_BACK_OFF_MAX
+#define RETRY_BACK_OFF 0
+#define RETRY_BACK_OFF_BASE 16
+#define RETRY_BACK_OFF_CAP 4096
+#define RETRY_BACK_OFF_MAX UINT16_MAX
+// Contention manager: an RMW ages by one for every round it loses on its key, and its proposes carry
+// that age. Acceptors nack the proposes that are younger than the proposal they hold, and a waiting
+// RMW does not steal the kv_ptr from an older one, so newer RMWs cannot starve an old one
+#define AGE_PRIORITY 0
+// An F&A that waits for the kv_ptr of a key that another session of the worker has proposed for
+// adds its addend to that session's RMW: one log slot commits the sum, and every F&A
+// gets its pre-value from the prefix sum of the addends
+#define COMBINE_FETCH_AND_ADDS 0
+// An RMW that waits for the kv_ptr of a key that another session of the worker holds queues behind
+// that session instead of polling the kv_ptr. When the owner commits, it grabs the kv_ptr for the
+// next RMW of the queue, which proposes for the next log number right away
+#define HANDOFF_QUEUE 0
+// Complete an RMW to its client as soon as a quorum has accepted it, i.e. once it is chosen, while its
+// commits and their acks continue in the background; the session stays stalled until the commit acks.
+// Not with READ_LEASES: a read served from the kv_ptr before the local commit would miss a returned RMW
+#define EARLY_RMW_COMPLETION 0
+// A commit that needs no value (all machines acked the accept) is not broadcast eagerly: the RMW
+// commits locally and the commit is implied by the next propose or accept of the key, which carries
+// the rmw-id committed in the previous log slot. Deferred commits are flushed in batches of up to
+// LAZY_COMMIT_BATCH, or after LAZY_COMMIT_TIMEOUT_CNT inspections of the RMW entries
+#define LAZY_COMMITS 0
+#define LAZY_COMMIT_BATCH 16
+#define LAZY_COMMIT_SESS (SESSIONS_PER_THREAD) // stands for the session of a flushed commit in the com_rob
+// The commit of an F&A or of an RMW operator with an 8-byte operand carries the operation instead of
+// the value, unless it can go without a value. A receiver that has accepted the RMW commits the
+// accepted value; one that holds the committed state of the previous log slot applies the operation.
+// Any other receiver drops the commit: an acceptor that nacked with LOG_TOO_HIGH gets the whole value
+// in the commit instead, the others when the next propose of the key pushes the previous commit.
+// The accepts of such an RMW carry only the bytes it changed, and the whole value once nacked with
+// LOG_TOO_HIGH. Not with READ_LEASES: a lease holder that drops a commit would serve older values
+#define SHIP_RMW_OPS_IN_COMMITS 1
+// An RMW works on the bytes [val_offset, val_offset + real_val_len) of the value of its trace op:
+// only those are compared, read back and changed, the rest of the value is carried over.
+// The trace picks the offset, clients work from the start of the value. Accepts of the session's own
+// RMW carry only the changed bytes, which the acceptors patch into the value they were taken from.
+// With SHIP_RMW_OPS_IN_COMMITS, commits of ranges of up to 8 bytes carry only the changed bytes
+#define PARTIAL_VALUE_RMWS 0
+// One key of the trace in COUNTER_KEY_SHARE is a counter, and stands for one of STRIPED_COUNTER_NUM
+// logical counters, each spread over COUNTER_STRIPES keys of the KVS: an F&A on a counter key runs
+// Paxos on the stripe of its session, and a read sends the quorum reads of all the stripes at once
+// and returns their sum. The sum is only regular: it counts every add completed before the read
+// started, and none that started after it ended. Other keys, and the other RMWs of a counter key,
+// are left alone. The stripes are the keys with the highest ids, which sessions never work on.
+// Not with EARLY_RMW_COMPLETION: an add completed at its accept quorum may be missing from the sum
+#define STRIPED_COUNTERS 0
+#define STRIPED_COUNTER_NUM 64
+#define COUNTER_STRIPES 8
+#define COUNTER_KEY_SHARE 16
+// A propose nacked with LOG_TOO_HIGH twice in a row, by machines that miss the previous commit of
+// the key, pushes the last commit of the kv_ptr and retries once it is acked, instead of retrying
+// LOG_TOO_HIGH_TIME_OUT times before pushing it. The first nack only retries, as the commit is
+// most often still on its way to the nacker
+#define LOG_TOO_HIGH_PUSH 0
 
 
 // TIMEOUTS
 #define WRITE_FIFO_TIMEOUT M_1
 #define RMW_BACK_OFF_TIMEOUT 1500 //K_32 //K_32// M_1
 #define ALL_ABOARD_TIMEOUT_CNT K_16
+#define THRIFTY_TIMEOUT_CNT K_16
 #define LOG_TOO_HIGH_TIME_OUT 10
+#define LAZY_COMMIT_TIMEOUT_CNT 64
+
+// CREDIT CALIBRATION (--auto-tune-credits)
+#define CREDIT_CALIBRATION_TIME_NS (1000 * 1000 * 1000) // 1 sec
+#define CREDIT_CALIBRATION_MIN_SAMPLES 1000
+#define RTT_EWMA_SHIFT 3 // new sample weighs 1/8
 
 
 
@@ -65,6 +171,20 @@ void cp_stats(stats_ctx_t *ctx);
 
 
 
+// Runtime knobs, bounded by the compile-time maxima above
+typedef struct cp_params {
+  uint16_t prop_credits;
+  uint16_t acc_credits;
+  uint16_t com_credits;
+  uint16_t prop_coalesce;
+  uint16_t acc_coalesce;
+  uint16_t com_coalesce;
+  bool auto_tune_credits; // measure peer rtt at start-up and pick credits to cover the bandwidth-delay product
+  uint16_t retry_back_off_base;
+  uint16_t retry_back_off_cap;
+} cp_params_t;
+extern cp_params_t cp_params;
+
 // unique RMW id-- each machine must remember how many
 // RMW each thread has committed, to avoid committing an RMW twice
 typedef struct rmw_id {
@@ -74,7 +194,9 @@ typedef struct rmw_id {
 
 
 #define MICA_VALUE_SIZE (VALUE_SIZE + (FIND_PADDING_CUST_ALIGN(VALUE_SIZE, 32)))
-#define MICA_OP_SIZE_  (100 + (2 * (MICA_VALUE_SIZE)))
+
+#define MICA_OP_PRIORITY_SIZE (AGE_PRIORITY ? 8 : 0)
+#define MICA_OP_SIZE_  (112 + MICA_OP_PRIORITY_SIZE + (2 * (MICA_VALUE_SIZE)))
 #define MICA_OP_PADDING_SIZE  (FIND_PADDING(MICA_OP_SIZE_))
 
 #define MICA_OP_SIZE  (MICA_OP_SIZE_ + MICA_OP_PADDING_SIZE)
@@ -90,7 +212,8 @@ typedef struct mica_op {
 
   uint8_t opcode; // what kind of RMW
   uint8_t state;
-  uint8_t unused[2];
+  bool lease_confirmed; // a quorum has promised our lease_ts
+  bool lease_revoked; // a higher ballot has been seen within the lease
 
   // BYTES: 20 - 32
   uint32_t log_no; // keep track of the biggest log_no that has not been committed
@@ -103,14 +226,21 @@ typedef struct mica_op {
   ts_tuple_t accepted_ts;
   ts_tuple_t base_acc_ts;
 
+  // BYTES: 64 - 72 -- the proposer lease: lease_ts.m_id owns the log numbers up to lease_end_log
+  ts_tuple_t lease_ts;
 
   // Cache-line 3 -- each rmw_id takes up 8 bytes
   struct rmw_id rmw_id;
   //struct rmw_id last_registered_rmw_id; // i was using it to put in accepts, when accepts carried last-registered-rmw-id
   struct rmw_id last_committed_rmw_id;
   struct rmw_id accepted_rmw_id; // not really needed, but useful for debugging
-  uint64_t epoch_id;
+  uint64_t epoch_id; // the read lease: its end in ns << 1 | READ_LEASE_CONFIRMED
   uint32_t key_id; // strictly for debug
+  uint32_t lease_end_log;
+#if AGE_PRIORITY
+  uint8_t prop_priority; // the age of the RMW that holds prop_ts
+  uint8_t unused_[7];
+#endif
 
   uint8_t padding[MICA_OP_PADDING_SIZE];
 } mica_op_t;
@@ -119,7 +249,8 @@ typedef struct fifo fifo_t;
 
 #define LOCAL_PROP_NUM_ (SESSIONS_PER_THREAD)
 #define LOCAL_PROP_NUM (ENABLE_RMWS == 1 ? LOCAL_PROP_NUM_ : 0)
-#define PROP_FIFO_SIZE (LOCAL_PROP_NUM + 1)
+// a read of a striped counter sends a propose per stripe
+#define PROP_FIFO_SIZE ((STRIPED_COUNTERS ? COUNTER_STRIPES : 1) * LOCAL_PROP_NUM + 1)
 #define ACC_FIFO_SIZE (LOCAL_PROP_NUM + 1)
 #define COM_FIFO_SIZE (LOCAL_PROP_NUM + 1)
 #define COM_ROB_SIZE (LOCAL_PROP_NUM + 1)
@@ -129,8 +260,16 @@ typedef struct fifo fifo_t;
 typedef struct cp_core_ctx cp_core_ctx_t;
 
 
-// Registering data structure
-extern atomic_uint_fast64_t committed_glob_sess_rmw_id[GLOBAL_SESSION_NUM];
+// Registering data structure: every worker registers commits of any global session and every
+// remote propose looks them up; PAD_COMMITTED_RMW_IDS gives each session its own cache line against false sharing
+typedef struct committed_rmw_id_slot {
+  atomic_uint_fast64_t rmw_id;
+} __attribute__((aligned(PAD_COMMITTED_RMW_IDS ? 64 : 8))) committed_rmw_id_slot_t;
+
+extern committed_rmw_id_slot_t committed_rmw_id_registry[GLOBAL_SESSION_NUM];
+#define committed_glob_sess_rmw_id(glob_sess_id) (committed_rmw_id_registry[(glob_sess_id)].rmw_id)
+// Per-worker conflict estimators that pick between All-aboard and Classic Paxos
+extern uint8_t all_aboard_conflicts[WORKERS_PER_MACHINE][ALL_ABOARD_BUCKETS];
 
 
 typedef struct trace_op {
@@ -145,6 +284,8 @@ typedef struct trace_op {
   uint8_t *value_to_read; //compare value for CAS/  addition argument for F&A
   uint32_t index_to_req_array;
   uint32_t real_val_len; // this is the value length the client is interested in
+  uint16_t val_offset; // PARTIAL_VALUE_RMWS: where in the value the bytes of the RMW start
+  struct mica_op **stripe_kv_ptrs; // STRIPED_COUNTERS: the stripes a read sums, NULL otherwise
 } trace_op_t;
 
 typedef struct thread_stats {
@@ -13,6 +13,7 @@ extern uint64_t seed;
 void cp_static_assert_compile_parameters();
 void cp_print_parameters_in_the_start();
 void cp_init_globals();
+int cp_handle_program_inputs(int argc, char *argv[]);
 
 
 void cp_init_qp_meta(context_t *ctx);
@@ -24,7 +24,8 @@
 
 // PROPOSES
 #define PROP_MES_HEADER (10) // local id + coalesce num + m_id
-#define PROP_SIZE (42 + 2) // l_id 8, RMW_id- 8, ts 5, key 8, log_number 4, opcode 1 + basets 8
+#define PREV_RMW_ID_SIZE (LAZY_COMMITS ? 8 : 0)
+#define PROP_SIZE (42 + 2 + PREV_RMW_ID_SIZE) // l_id 8, RMW_id- 8, ts 5, key 8, log_number 4, opcode 1 + basets 8, priority 1, prev rmw_id 8 with LAZY_COMMITS
 #define PROP_MES_SIZE (PROP_MES_HEADER + (PROP_SIZE * PROP_COALESCE))
 #define PROP_RECV_SIZE (GRH_SIZE + PROP_MES_SIZE)
 
@@ -37,6 +38,7 @@
 #define RMW_REP_MES_HEADER (11) //l_id 8 , coalesce_num 1, m_id 1, opcode 1 TODO remove opcode
 #define RMW_REP_SMALL_SIZE 9 // lid and opcode
 #define RMW_REP_ONLY_TS_SIZE (9 + TS_TUPLE_SIZE)
+#define READ_LEASE_NACK_SIZE (RMW_REP_ONLY_TS_SIZE + RMW_VALUE_SIZE + 8) // up to the rmw_id
 // PROPOSE REPLIES
 #define PROP_REP_LOG_TOO_LOW_SIZE (26 + RMW_VALUE_SIZE)  //l_id- 8, RMW_id- 8, ts 5, log_no - 4,  RMW value, opcode 1
 #define PROP_REP_BASE_TS_STALE_SIZE (9 + TS_TUPLE_SIZE + RMW_VALUE_SIZE)
@@ -64,8 +66,10 @@
 
 // ACCEPTS -- ACCEPT coalescing is derived from max write capacity. ACC reps are derived from accept coalescing
 #define ACC_MES_HEADER (10) //l_id 8 , coalesce_num 1
-#define ACC_HEADER (35 + 5 + 4) //original l_id 8 key 8 rmw-id 10, last-committed rmw_id 10, ts 5 log_no 4 opcode 1, val_len 1
+#define ACC_HEADER (35 + 5 + 4 + PREV_RMW_ID_SIZE) //original l_id 8 key 8 rmw-id 10, last-committed rmw_id 10, ts 5 log_no 4 opcode 1, val_len 1, prev rmw_id 8 with LAZY_COMMITS
 #define ACC_SIZE (ACC_HEADER + RMW_VALUE_SIZE)
+// ACCEPT_RANGE: an accept that carries only the bytes the RMW changed, and their offset
+#define ACC_RANGE_SIZE(len) (ACC_HEADER + 2 + (len))
 #define ACC_MES_SIZE (ACC_MES_HEADER + (ACC_SIZE * ACC_COALESCE))
 #define ACC_RECV_SIZE (GRH_SIZE + ACC_MES_SIZE)
 
@@ -90,6 +94,10 @@
 // COMMIT_NO_VAL
 #define COMMIT_NO_VAL_SIZE (22 + 2)
 #define COM_NO_VAL_MES_SIZE MAX_COM_SIZE
+// COMMIT_DELTA: the operation of the RMW instead of its value
+#define COM_DELTA_SIZE (28 + 8 + 2)
+// COMMIT_RANGE: a commit followed by the rmw-ids of the next (count - 1) log slots
+#define COM_RANGE_SIZE(count) (COM_SIZE + (((count) - 1) * sizeof(uint64_t)))
 
 #define COM_COALESCE (MAX_COM_SIZE_NO_HDR / COM_SIZE)
 #define COM_NO_VAL_COALESCE (MAX_COM_SIZE_NO_HDR / COMMIT_NO_VAL_SIZE)
@@ -102,13 +110,17 @@
 typedef struct propose {
   struct network_ts_tuple ts;
   uint8_t opcode;
-  uint8_t unused[2];
+  uint8_t priority; // AGE_PRIORITY: the age of the proposing RMW
+  uint8_t unused;
   mica_key_t key;
 
   uint64_t t_rmw_id;
   uint32_t log_no;
   uint64_t l_id; // the l_id of the rmw local_entry
   ts_tuple_t base_ts;
+#if LAZY_COMMITS
+  uint64_t prev_rmw_id; // the rmw-id committed in log_no - 1, 0 if unknown
+#endif
 } __attribute__((__packed__)) cp_prop_t;
 
 typedef struct cp_prop_mes {
@@ -159,10 +171,37 @@ typedef struct accept {
   uint64_t l_id;
   uint32_t log_no;
   ts_tuple_t base_ts;
+#if LAZY_COMMITS
+  uint64_t prev_rmw_id; // the rmw-id committed in log_no - 1, 0 if unknown
+#endif
   //uint8_t unused_[3];
   uint8_t value[RMW_VALUE_SIZE];
 } __attribute__((__packed__)) cp_acc_t;
 
+// Shares its header with the accept: the value is replaced by the bytes the RMW works on
+typedef struct accept_range {
+  struct network_ts_tuple ts;
+  uint8_t opcode;
+  uint8_t val_len; // the number of bytes carried
+  uint8_t unused;
+  mica_key_t key;
+  uint64_t t_rmw_id;
+  uint64_t l_id;
+  uint32_t log_no;
+  ts_tuple_t base_ts; // the ts of the value whose bytes are replaced
+#if LAZY_COMMITS
+  uint64_t prev_rmw_id;
+#endif
+  uint16_t val_offset;
+  uint8_t bytes[];
+} __attribute__((__packed__)) cp_acc_range_t;
+
+static inline uint16_t get_acc_size(cp_acc_t *acc)
+{
+  return acc->opcode == ACCEPT_RANGE_OP ?
+         (uint16_t) ACC_RANGE_SIZE(acc->val_len) : (uint16_t) ACC_SIZE;
+}
+
 typedef struct cp_acc_mes {
   uint64_t l_id;
   uint8_t coalesce_num;
@@ -197,6 +236,31 @@ typedef struct commit {
   uint8_t value[VALUE_SIZE];
 } __attribute__((__packed__)) cp_com_t;
 
+// Shares its header with the commit: the value is replaced by the operand of the RMW
+typedef struct commit_delta {
+  struct network_ts_tuple base_ts; // the ts of the value the operation was applied on
+  uint8_t opcode;
+  uint8_t val_len;
+  uint8_t rmw_opcode;
+  mica_key_t key;
+  uint64_t t_rmw_id; //rmw lid to be committed
+  uint32_t log_no;
+  uint8_t operand[8];
+  uint16_t val_offset; // PARTIAL_VALUE_RMWS: where in the value the operation is applied
+} __attribute__((__packed__)) cp_com_delta_t;
+
+// Shares its layout with the commit, such that a commit can be turned into a range in place
+typedef struct commit_range {
+  struct network_ts_tuple base_ts; // of the last slot
+  uint8_t opcode;
+  uint8_t count;
+  uint8_t unused;
+  mica_key_t key;
+  uint64_t t_rmw_id; // of the first slot
+  uint32_t first_log;
+  uint8_t value[VALUE_SIZE]; // of the last slot
+  uint64_t t_rmw_ids[]; // of slots first_log + 1 ... first_log + count - 1
+} __attribute__((__packed__)) cp_com_range_t;
 
 typedef struct cp_com_mes {
   uint64_t l_id;
@@ -212,18 +276,45 @@ typedef struct cp_com_message_ud_req {
   cp_com_mes_t com_mes;
 } cp_com_mes_ud_t;
 
+static inline uint16_t get_com_size(cp_com_t *com)
+{
+  switch (com->opcode) {
+    case COMMIT_OP:
+      return COM_SIZE;
+    case COMMIT_OP_NO_VAL:
+      return COMMIT_NO_VAL_SIZE;
+    case COMMIT_DELTA_OP:
+      return COM_DELTA_SIZE;
+    case COMMIT_RANGE_OP:
+      return (uint16_t) COM_RANGE_SIZE(((cp_com_range_t *) com)->count);
+    default: if (ENABLE_ASSERTIONS) {
+        my_printf(red, "Opcode %u \n", com->opcode);
+        assert(false);
+      }
+  }
+}
+
+// How many commits (i.e. l_ids to be acked) an entry stands for
+static inline uint8_t get_com_commit_num(cp_com_t *com)
+{
+  return com->opcode == COMMIT_RANGE_OP ? ((cp_com_range_t *) com)->count : (uint8_t) 1;
+}
+
 // Give an opcode to get the capacity of the read rep messages
 static inline uint16_t get_size_from_opcode(uint8_t opcode)
 {
-  if (opcode > CARTS_EQUAL) opcode -= FALSE_POSITIVE_OFFSET;
+  if (opcode >= TS_TOO_HIGH + FALSE_POSITIVE_OFFSET) opcode -= FALSE_POSITIVE_OFFSET;
   switch(opcode) {
     case LOG_TOO_SMALL:
       return PROP_REP_LOG_TOO_LOW_SIZE;
     case SEEN_LOWER_ACC:
+    case QUORUM_READ_REP:
       return PROP_REP_ACCEPTED_SIZE;
     case SEEN_HIGHER_PROP:
     case SEEN_HIGHER_ACC:
       return RMW_REP_ONLY_TS_SIZE;
+    case READ_LEASE_NACK:
+      return READ_LEASE_NACK_SIZE;
     case RMW_ACK_BASE_TS_STALE:
       return PROP_REP_BASE_TS_STALE_SIZE;
     case RMW_ID_COMMITTED:
@@ -9,6 +9,18 @@
 
 #define OP_GET_TS 118 // first round of release, or out-of-epoch write
 #define UPDATE_EPOCH_OP_GET 119
+#define COMMIT_RANGE_OP 120 // commits consecutive log slots of a key, carries only the last value
+#define QUORUM_READ_OP 121 // travels as a propose: asks for the committed state of a key
+#define ACCEPT_RANGE_OP 122 // an accept that carries only the bytes the RMW changed
+#define COMMIT_DELTA_OP 150 // a commit that carries the operation of the RMW instead of its value
+// RMW operators: the opcodes from RMW_OPERATOR_BASE on index the table of cp_rmw_operators.h
+#define RMW_OPERATOR_BASE 160
+#define RMW_OP_MAX 160
+#define RMW_OP_MIN 161
+#define RMW_OP_BIT_OR 162
+#define RMW_OP_BOUNDED_DEC 163
+#define RMW_OP_APPEND 164
+#define RMW_OPERATOR_NUM 5
 
 
 // READ_REPLIES
@@ -23,7 +35,7 @@
 #define TS_TOO_HIGH 28
 #define TS_EQUAL 29
 #define TS_TOO_SMALL 30 // Response when reading the ts only (1st round of release)
-//#define TS_GREATER 31
+#define QUORUM_READ_REP 31 // last committed log no, ts and value, and the newest uncommitted accepted log no
 #define RMW_ACK 32 // 1 byte reply
 #define RMW_ACK_ACC_SAME_RMW 33 // only for proposes: Have accepted with lower TS the same RMW-id, it counts as an ack
 #define RMW_ACK_BASE_TS_STALE 33 // the propose is acked, but we let it know o f a recent ABD write
@@ -41,6 +53,9 @@
 #define CARTS_TOO_SMALL 42
 #define CARTS_TOO_HIGH 43
 #define CARTS_EQUAL 44
+// READ_LEASES: an accept nacked by the read lease of another machine, sends the propose TS
+// of the acceptor and, in the rmw_id, the ns the lease has left
+#define READ_LEASE_NACK 45
 
 // this offset is added to the read reply opcode
 // to denote that the machine doing the acquire was
@@ -66,6 +81,9 @@
 #define MUST_BCAST_COMMITS_FROM_HELP 6 // broadcast commits using the help_loc_entry as the source
 #define COMMITTED 7 // Local entry only: bcasts broadcasted, but session not yet freed
 #define CAS_FAILED 8
+#define QUORUM_READ 9 // Local entry only: a read waiting for a quorum of replies
+#define COMBINED 10 // Local entry only: an F&A riding on the RMW of another session of the worker
+#define HANDOFF_QUEUED 11 // Local entry only: queued for the kv_ptr behind another session of the worker
 
 /*
  *  SENT means the message has been sent
@@ -115,6 +133,8 @@ enum {
   FROM_LOCAL_HELP,
   FROM_REMOTE_COMMIT,
   FROM_REMOTE_COMMIT_NO_VAL,
+  FROM_REMOTE_COMMIT_RANGE,
+  FROM_REMOTE_COMMIT_DELTA,
   FROM_LOCAL_ACQUIRE,
   FROM_OOE_READ,
   //-- used only for writing kv_ptr->value
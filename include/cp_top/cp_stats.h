@@ -5,8 +5,47 @@
 #ifndef ODYSSEY_CP_STATS_H
 #define ODYSSEY_CP_STATS_H
 
+#include <od_top.h>
+
 typedef struct thread_stats t_stats_t;
 
+// Per-worker counters of cp that odyssey's thread_stats does not have.
+// Every field must be a uint64_t counter: they are diffed as an array of words
+typedef struct cp_stats {
+  uint64_t deferred_prop_loops; // loops the proposes were held back for commits/accepts
+  uint64_t lent_credits; // credits lent to machines lagging behind a quorum
+  uint64_t leased_rmws; // RMWs that went straight to accepts on a proposer lease
+  uint64_t all_aboard_picks; // RMWs the conflict estimator let try All-aboard
+  uint64_t classic_picks; // RMWs the conflict estimator sent to Classic Paxos instead
+  uint64_t thrifty_sends; // prop/acc sends that went to the thrifty quorum only
+  uint64_t quorum_widenings; // nacked or timed-out rounds that widened the sends to all machines
+  uint64_t quorum_reads; // reads completed in one round trip
+  uint64_t quorum_read_fallbacks; // reads that had to be performed as an F&A of 0
+  uint64_t read_lease_hits; // reads served from the kv_ptr under the read lease
+  uint64_t read_lease_misses; // reads of the designated replica that found no valid lease
+  uint64_t nacked_retries; // retries with a bigger ts after a nack for a higher ballot
+  uint64_t retry_back_off_waits; // inspections spent backing off before such retries
+  uint64_t priority_deferrals; // proposes nacked and steals skipped in favour of an older RMW
+  uint64_t combined_faas; // F&As that rode on the RMW of another session
+  uint64_t handoff_queued; // RMWs queued behind another session of the worker
+  uint64_t handoffs; // kv_ptrs handed over on commit to the next RMW of the queue
+  uint64_t early_completions; // RMWs completed to the client at the accept quorum
+  uint64_t lazy_commits; // commits without a value that were deferred
+  uint64_t lazy_commit_flushes; // deferred commits that were eventually broadcast
+  uint64_t implied_commits; // accepted RMWs committed by the next propose or accept of their key
+  uint64_t shipped_rmw_ops; // commits that carried the operation of the RMW instead of its value
+  uint64_t rebuilt_rmw_ops; // received such commits applied on the previous committed value
+  uint64_t ignored_rmw_ops; // received such commits that found neither the RMW nor its base
+  uint64_t acc_val_ranges; // accepts that carried only the bytes the RMW changed
+  uint64_t nacked_acc_val_ranges; // received such accepts that did not find the value they patch
+  uint64_t striped_reads; // reads that summed the stripes of a counter
+  uint64_t stripe_rereads; // stripes read again after the quorum read timed out
+  uint64_t log_too_high_pushes; // previous commits pushed on a repeated LOG_TOO_HIGH nack
+  uint64_t com_range_slots; // commits folded into the range of the previous log slot of their key
+} __attribute__((aligned(64))) cp_stats_t;
+
+extern cp_stats_t cp_t_stats[WORKERS_PER_MACHINE];
+
 void cp_dump_stats_2_file(t_stats_t* st);
 void print_latency_stats(void);
 
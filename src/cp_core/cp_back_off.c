@@ -4,6 +4,7 @@
 
 
 #include <cp_core_common_util.h>
+#include <cp_stats.h>
 #include <cp_netw_interface.h>
 
 
@@ -33,12 +34,15 @@ static inline bool grab_invalid_kv_ptr_after_waiting(mica_op_t *kv_ptr,
                                                      uint16_t t_id)
 {
   if (rmw_fails_with_loc_entry(loc_entry, kv_ptr, rmw_fails, t_id))  return false;
+  if (read_lease_blocks_accept(kv_ptr, (uint8_t) machine_id)) return false;
 
   loc_entry->log_no = kv_ptr->last_committed_log_no + 1;
-  activate_kv_pair(PROPOSED, PAXOS_TS, kv_ptr, loc_entry->opcode,
+  loc_entry->new_ts.version = version_outbidding_proposer_lease(kv_ptr, PAXOS_TS, loc_entry->log_no);
+  activate_kv_pair(PROPOSED, loc_entry->new_ts.version, kv_ptr, loc_entry->opcode,
                    (uint8_t) machine_id, NULL, loc_entry->rmw_id.id,
                    loc_entry->log_no, t_id,
                    ENABLE_ASSERTIONS ? "attempt_to_grab_kv_ptr_after_waiting" : NULL);
+  kv_ptr_takes_priority(kv_ptr, loc_entry->priority);
   print_when_grabbing_kv_ptr(loc_entry, t_id);
   return true;
 }
@@ -84,7 +88,7 @@ static inline void if_grabbed_fill_loc_if_failed_free_session(sess_stall_t *stal
                                                               uint16_t t_id)
 {
   if (kv_ptr_was_grabbed) {
-    fill_loc_rmw_entry_on_grabbing_kv_ptr(loc_entry, PAXOS_TS,
+    fill_loc_rmw_entry_on_grabbing_kv_ptr(loc_entry, loc_entry->new_ts.version,
                                           PROPOSED, sess_i, t_id);
   }
   else if (rmw_fails) {
@@ -132,9 +136,11 @@ static inline void bookkeep_kv_ptr_and_loc_entry_due_to_lower_accept_rep(mica_op
                                                                          loc_entry_t *loc_entry)
 {
   loc_entry->log_no = kv_ptr->accepted_log_no;
-  loc_entry->new_ts.version = kv_ptr->prop_ts.version + 1;
+  loc_entry->new_ts.version = version_outbidding_proposer_lease(kv_ptr, kv_ptr->prop_ts.version + 1,
+                                                                loc_entry->log_no);
   loc_entry->new_ts.m_id = (uint8_t) machine_id;
   kv_ptr->prop_ts = loc_entry->new_ts;
+  grant_proposer_lease(kv_ptr, &loc_entry->new_ts, loc_entry->log_no);
 }
 
 
@@ -177,11 +183,13 @@ static inline void steal_the_stucked_proposed_rmw(loc_entry_t *loc_entry,
 {
   check_the_proposed_log_no(kv_ptr, loc_entry, t_id);
   loc_entry->log_no = kv_ptr->last_committed_log_no + 1;
-  *new_version = kv_ptr->prop_ts.version + 1;
+  *new_version = version_outbidding_proposer_lease(kv_ptr, kv_ptr->prop_ts.version + 1,
+                                                   loc_entry->log_no);
   activate_kv_pair(PROPOSED, *new_version, kv_ptr, loc_entry->opcode,
                    (uint8_t) machine_id, NULL, loc_entry->rmw_id.id,
                    loc_entry->log_no, t_id,
                    ENABLE_ASSERTIONS ? "attempt_to_steal_a_proposed_kv_ptr" : NULL);
+  kv_ptr_takes_priority(kv_ptr, loc_entry->priority);
   loc_entry->base_ts = kv_ptr->ts;
 }
 
@@ -190,6 +198,11 @@ static inline bool steal_if_invalid_or_state_has_not_changed(loc_entry_t *loc_en
                                                              uint32_t *new_version,
                                                              uint16_t t_id)
 {
+  if (read_lease_blocks_accept(kv_ptr, (uint8_t) machine_id)) return false;
+  if (older_rmw_holds_kv_ptr(kv_ptr, loc_entry->priority)) {
+    if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].priority_deferrals++;
+    return false;
+  }
   bool invalid_or_state_has_not_changed =
       kv_ptr->state == INVALID_RMW || kv_ptr_state_has_not_changed(kv_ptr, loc_entry->help_rmw);
 
@@ -252,6 +265,84 @@ static inline void clean_up_if_proposed_after_needs_kv_ptr(cp_core_ctx_t *cp_cor
 
 
 
+/* ---------------------------------------------------------------------------
+//------------------------------ COMBINING F&As -----------------------------
+//---------------------------------------------------------------------------*/
+
+// The session of the worker whose RMW held the kv_ptr when the entry last looked at it
+static inline loc_entry_t *local_owner_of_kv_ptr(cp_core_ctx_t *cp_core_ctx,
+                                                  loc_entry_t *loc_entry)
+{
+  uint64_t owner_rmw_id = loc_entry->help_rmw->rmw_id.id;
+  uint32_t owner_glob_sess_id = (uint32_t) (owner_rmw_id % GLOBAL_SESSION_NUM);
+  uint32_t first_glob_sess_id = loc_entry->glob_sess_id - loc_entry->sess_id;
+  if (owner_glob_sess_id < first_glob_sess_id ||
+      owner_glob_sess_id >= first_glob_sess_id + SESSIONS_PER_THREAD) return NULL;
+
+  loc_entry_t *owner = &cp_core_ctx->rmw_entries[owner_glob_sess_id - first_glob_sess_id];
+  bool is_owner = owner != loc_entry &&
+                  owner->glob_sess_id == owner_glob_sess_id &&
+                  owner->rmw_id.id == owner_rmw_id &&
+                  owner->kv_ptr == loc_entry->kv_ptr;
+  return is_owner ? owner : NULL;
+}
+
+// An F&A that has never been accepted rides on the F&A of the owner, if that has not yet been accepted
+static inline bool combine_with_local_owner(loc_entry_t *owner,
+                                            loc_entry_t *loc_entry,
+                                            uint16_t t_id)
+{
+  if (!COMBINE_FETCH_AND_ADDS || loc_entry->opcode != FETCH_AND_ADD ||
+      loc_entry->helping_flag != NOT_HELPING || loc_entry->accepted_log_no != 0 ||
+      loc_entry->combined_next != NULL) return false;
+  if (owner->state != PROPOSED || owner->opcode != FETCH_AND_ADD ||
+      owner->helping_flag != NOT_HELPING || owner->accepted_log_no != 0) return false;
+  if (owner->val_offset != loc_entry->val_offset) return false;
+
+  owner->combined_addend += *(uint64_t *) loc_entry->compare_val;
+  loc_entry->combined_next = owner->combined_next;
+  owner->combined_next = loc_entry;
+  loc_entry->state = COMBINED;
+  if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].combined_faas++;
+  return true;
+}
+
+/* ---------------------------------------------------------------------------
+//------------------------------ HANDOFF QUEUE ------------------------------
+//---------------------------------------------------------------------------*/
+
+// An RMW that has never been accepted queues behind the owner, along with its own queue,
+// and stops polling the kv_ptr until the owner hands it over
+static inline bool queue_behind_local_owner(loc_entry_t *owner,
+                                            loc_entry_t *loc_entry,
+                                            uint16_t t_id)
+{
+  if (!HANDOFF_QUEUE || loc_entry->helping_flag != NOT_HELPING ||
+      loc_entry->accepted_log_no != 0) return false;
+  if (owner->state == INVALID_RMW || owner->state == COMBINED ||
+      owner->state == HANDOFF_QUEUED || owner->state == QUORUM_READ ||
+      owner->state == CAS_FAILED) return false;
+
+  loc_entry_t *tail = loc_entry->handoff_next == NULL ? loc_entry : loc_entry->handoff_tail;
+  if (owner->handoff_next == NULL) owner->handoff_next = loc_entry;
+  else owner->handoff_tail->handoff_next = loc_entry;
+  owner->handoff_tail = tail;
+  loc_entry->handoff_tail = NULL;
+  loc_entry->state = HANDOFF_QUEUED;
+  if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].handoff_queued++;
+  return true;
+}
+
+static inline bool wait_on_local_owner(cp_core_ctx_t *cp_core_ctx,
+                                       loc_entry_t *loc_entry)
+{
+  if (!COMBINE_FETCH_AND_ADDS && !HANDOFF_QUEUE) return false;
+  loc_entry_t *owner = local_owner_of_kv_ptr(cp_core_ctx, loc_entry);
+  if (owner == NULL) return false;
+  return combine_with_local_owner(owner, loc_entry, cp_core_ctx->t_id) ||
+         queue_behind_local_owner(owner, loc_entry, cp_core_ctx->t_id);
+}
+
 // local_entry->state = NEEDS_KV_PTR
 inline void handle_needs_kv_ptr_state(cp_core_ctx_t *cp_core_ctx,
                                       loc_entry_t *loc_entry,
@@ -259,6 +350,7 @@ inline void handle_needs_kv_ptr_state(cp_core_ctx_t *cp_core_ctx,
                                       uint16_t t_id)
 {
   mica_op_t *kv_ptr = loc_entry->kv_ptr;
+  if (wait_on_local_owner(cp_core_ctx, loc_entry)) return;
 
   if (!attempt_to_grab_kv_ptr_after_waiting(cp_core_ctx->stall_info, kv_ptr, loc_entry,
                                             sess_i, t_id)) {
@@ -266,6 +358,7 @@ inline void handle_needs_kv_ptr_state(cp_core_ctx_t *cp_core_ctx,
     loc_entry->back_off_cntr++;
     if (loc_entry->back_off_cntr == RMW_BACK_OFF_TIMEOUT) {
       print_needs_kv_ptr_timeout_expires(loc_entry, sess_i, t_id);
+      rmw_loses_a_round(loc_entry);
 
       if (loc_entry->help_rmw->state == ACCEPTED)
         attempt_to_help_a_locally_accepted_value(cp_core_ctx->stall_info, loc_entry, kv_ptr, t_id);
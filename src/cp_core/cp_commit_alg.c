@@ -4,6 +4,8 @@
 
 #include <cp_core_interface.h>
 #include <cp_core_common_util.h>
+#include <cp_netw_interface.h>
+#include <cp_stats.h>
 
 
 
@@ -26,6 +28,10 @@ static inline void process_commit_flags(void* rmw, loc_entry_t *loc_entry, uint8
     case FROM_REMOTE_COMMIT:
       if (com->opcode == COMMIT_OP_NO_VAL)
         *flag = FROM_REMOTE_COMMIT_NO_VAL;
+      else if (com->opcode == COMMIT_RANGE_OP)
+        *flag = FROM_REMOTE_COMMIT_RANGE;
+      else if (com->opcode == COMMIT_DELTA_OP)
+        *flag = FROM_REMOTE_COMMIT_DELTA;
       break;
     case FROM_LOCAL_ACQUIRE:
     case FROM_OOE_READ:
@@ -50,6 +56,8 @@ static inline void fill_commit_info(commit_info_t *com_info, uint8_t flag,
   com_info->message = committing_flag_to_str(flag);
   com_info->no_value = false;
   com_info->flag = flag;
+  com_info->range = NULL;
+  com_info->delta = NULL;
 }
 
 
@@ -109,38 +117,103 @@ static inline void fill_commit_info_from_rem_commit_no_val(commit_info_t *com_in
   com_info->no_value = true;
 }
 
+// The value is rebuilt under the lock of the kv_ptr
+static inline void fill_commit_info_from_rem_commit_delta(commit_info_t *com_info,
+                                                          void* rmw,
+                                                          uint8_t flag)
+{
+  ts_tuple_t base_ts = {0, 0};
+  cp_com_delta_t *com_delta = (cp_com_delta_t *) rmw;
+  assign_netw_ts_to_ts(&base_ts, &com_delta->base_ts);
+  fill_commit_info(com_info, flag, com_delta->t_rmw_id,
+                   com_delta->log_no, base_ts, NULL, true);
+  com_info->delta = com_delta;
+}
+
+// Commit the last slot of the range; its value subsumes the rest
+static inline void fill_commit_info_from_rem_commit_range(commit_info_t *com_info,
+                                                          void* rmw,
+                                                          uint8_t flag)
+{
+  ts_tuple_t base_ts = {0, 0};
+  cp_com_range_t *range = (cp_com_range_t *) rmw;
+  if (ENABLE_ASSERTIONS) assert(range->count > 1);
+  uint8_t last = (uint8_t) (range->count - 1);
+  assign_netw_ts_to_ts(&base_ts, &range->base_ts);
+  fill_commit_info(com_info, flag, range->t_rmw_ids[last - 1],
+                   range->first_log + last, base_ts, range->value, true);
+  com_info->range = range;
+}
 
 
 
+// The value of a commit without a value is the one the kv_ptr accepted, provided
+// the kv_ptr still holds the accept of that very RMW for that log
 static inline bool can_process_com_no_value(mica_op_t *kv_ptr,
                                             commit_info_t *com_info,
                                             uint16_t t_id)
 {
+  if (kv_ptr->accepted_log_no != com_info->log_no ||
+      kv_ptr->rmw_id.id != com_info->rmw_id.id)
+    return false;
 
-  if (kv_ptr->last_committed_log_no < com_info->log_no) {
-    com_info->base_ts = kv_ptr->base_acc_ts;
-    com_info->value = kv_ptr->last_accepted_value;
-    return true;
-  }
-
-  return false;
+  com_info->base_ts = kv_ptr->base_acc_ts;
+  com_info->value = kv_ptr->last_accepted_value;
+  return true;
 }
 
 
 
 
-// Check if it's a commit without a value -- if it cannot be committed
-// then do not attempt to overwrite the value and timestamp, because the commit's
-// value and ts are stored in the kv_ptr->accepted_value/ts and may have been lost
-static inline void handle_commit_with_no_val (mica_op_t *kv_ptr,
+// Check if it's a commit without a value -- if the log has already been committed
+// then do not attempt to overwrite the value and timestamp. If it has not and the
+// kv_ptr does not hold the accepted value, the commit is dropped (returns false):
+// the kv_ptr must not advance its log without the value, and it catches up when
+// the log is committed again with its value, through the log-too-high/low replies
+static inline bool handle_commit_with_no_val (mica_op_t *kv_ptr,
                                               commit_info_t *com_info,
                                               uint16_t t_id)
 {
-  if (com_info->no_value) {
-    if (!can_process_com_no_value(kv_ptr, com_info, t_id)) {
-      com_info->overwrite_kv = false;
-    }
+  if (!com_info->no_value) return true;
+  if (kv_ptr->last_committed_log_no >= com_info->log_no) {
+    com_info->overwrite_kv = false;
+    return true;
+  }
+  if (can_process_com_no_value(kv_ptr, com_info, t_id)) return true;
+  return false;
+}
+
+// A commit that carries the operation of the RMW takes the accepted value if the kv_ptr has
+// accepted the RMW, or applies the operation if the kv_ptr holds the value it was applied on.
+// Otherwise it is ignored: returns false and the kv_ptr catches up through the log-too-low replies
+static inline bool handle_commit_with_rmw_op(mica_op_t *kv_ptr,
+                                             commit_info_t *com_info,
+                                             uint16_t t_id)
+{
+  cp_com_delta_t *com_delta = com_info->delta;
+  if (com_delta == NULL) return true;
+
+  if (kv_ptr->last_committed_log_no >= com_info->log_no) {
+    com_info->overwrite_kv = false;
+    return true;
+  }
+  if (kv_ptr->state == ACCEPTED && kv_ptr->log_no == com_info->log_no &&
+      kv_ptr->rmw_id.id == com_info->rmw_id.id) {
+    com_info->value = kv_ptr->last_accepted_value;
+    return true;
+  }
+  if (kv_ptr->last_committed_log_no + 1 == com_info->log_no &&
+      compare_ts(&kv_ptr->ts, &com_info->base_ts) == EQUAL) {
+    // the operation is applied in place, the value needs no overwriting
+    apply_shipped_rmw_op(com_delta->rmw_opcode,
+                         rmw_bytes_of_value(kv_ptr->value, com_delta->val_offset),
+                         com_delta->operand, com_delta->val_len);
+    com_info->overwrite_kv = false;
+    if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].rebuilt_rmw_ops++;
+    return true;
   }
+  if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].ignored_rmw_ops++;
+  return false;
 }
 
 static inline void clear_kv_state_advance_log_no (mica_op_t *kv_ptr,
@@ -185,40 +258,59 @@ static inline void register_committed_rmw_id (uint64_t rmw_id,
 {
   uint64_t glob_sess_id = rmw_id % GLOBAL_SESSION_NUM;
   uint32_t debug_cntr = 0;
-  uint64_t tmp_rmw_id = committed_glob_sess_rmw_id[glob_sess_id];
+  uint64_t tmp_rmw_id = committed_glob_sess_rmw_id(glob_sess_id);
   do {
     debug_stalling_on_lock(&debug_cntr, "registering rmw", t_id);
     if (rmw_id <= tmp_rmw_id) return;
-  } while (!atomic_compare_exchange_strong(&committed_glob_sess_rmw_id[glob_sess_id],
+  } while (!atomic_compare_exchange_strong(&committed_glob_sess_rmw_id(glob_sess_id),
                                            &tmp_rmw_id, rmw_id));
 }
 
 
 
 
+static inline void register_earlier_slots_of_range(commit_info_t *com_info,
+                                                   uint16_t t_id)
+{
+  cp_com_range_t *range = com_info->range;
+  if (range == NULL) return;
+  register_committed_rmw_id(range->t_rmw_id, t_id);
+  for (uint8_t i = 0; i < range->count - 2; i++)
+    register_committed_rmw_id(range->t_rmw_ids[i], t_id);
+}
+
 static inline void register_commit(mica_op_t *kv_ptr,
                                    commit_info_t *com_info,
                                    uint16_t t_id)
 {
+  register_earlier_slots_of_range(com_info, t_id);
   register_committed_rmw_id(com_info->rmw_id.id, t_id);
   check_registered_against_kv_ptr_last_committed(kv_ptr, com_info->rmw_id.id,
                                                  com_info->message, t_id);
 }
 
+// The kv_ptr must be locked
+static inline void commit_algorithm_on_locked_kv_ptr(mica_op_t *kv_ptr,
+                                                     commit_info_t *com_info,
+                                                     uint16_t t_id)
+{
+  check_state_before_commit_algorithm(kv_ptr, com_info, t_id);
+  if (!handle_commit_with_rmw_op(kv_ptr, com_info, t_id)) return;
+  if (!handle_commit_with_no_val(kv_ptr, com_info, t_id)) return;
+  clear_kv_state_advance_log_no(kv_ptr, com_info);
+  apply_val_if_carts_bigger(kv_ptr, com_info, t_id);
+  advance_last_comm_log_no_and_rmw_id(kv_ptr, com_info, t_id);
+  register_commit(kv_ptr, com_info, t_id);
+}
+
 static inline void commit_algorithm(mica_op_t *kv_ptr,
                                     commit_info_t *com_info,
                                     uint16_t t_id)
 {
   check_inputs_commit_algorithm(kv_ptr, com_info, t_id);
 
-  lock_kv_ptr(kv_ptr, t_id); {
-    check_state_before_commit_algorithm(kv_ptr, com_info, t_id);
-    handle_commit_with_no_val(kv_ptr, com_info, t_id);
-    clear_kv_state_advance_log_no(kv_ptr, com_info);
-    apply_val_if_carts_bigger(kv_ptr, com_info, t_id);
-    advance_last_comm_log_no_and_rmw_id(kv_ptr, com_info, t_id);
-    register_commit(kv_ptr, com_info, t_id);
-  }
+  lock_kv_ptr(kv_ptr, t_id);
+  commit_algorithm_on_locked_kv_ptr(kv_ptr, com_info, t_id);
   unlock_kv_ptr(kv_ptr, t_id);
 }
 
@@ -245,6 +337,12 @@ static inline void fil_commit_info_based_on_flag(void* rmw,
     case FROM_REMOTE_COMMIT_NO_VAL:
       fill_commit_info_from_rem_commit_no_val(com_info, rmw, flag);
       break;
+    case FROM_REMOTE_COMMIT_RANGE:
+      fill_commit_info_from_rem_commit_range(com_info, rmw, flag);
+      break;
+    case FROM_REMOTE_COMMIT_DELTA:
+      fill_commit_info_from_rem_commit_delta(com_info, rmw, flag);
+      break;
     default: my_assert(false, "");
   }
 }
@@ -263,15 +361,51 @@ inline void commit_rmw(mica_op_t *kv_ptr,
 }
 
 
-static inline void free_session_and_reinstate_loc_entry(sess_stall_t *stall_info,
-                                                        loc_entry_t *loc_entry,
-                                                        uint16_t t_id)
+// Right after the commit, grab the freed kv_ptr for the first RMW queued behind the committed one.
+// A CAS that may fail early goes through the regular grab instead
+static inline void hand_off_kv_ptr(cp_core_ctx_t *cp_core_ctx,
+                                   loc_entry_t *loc_entry)
 {
+  if (!HANDOFF_QUEUE || loc_entry->handoff_next == NULL ||
+      loc_entry->handoff_next->killable) return;
+  loc_entry_t *next = loc_entry->handoff_next;
+  mica_op_t *kv_ptr = next->kv_ptr;
+  uint16_t t_id = cp_core_ctx->t_id;
+  bool kv_ptr_was_grabbed = false;
+
+  lock_kv_ptr(kv_ptr, t_id);
+  if (kv_ptr->state == INVALID_RMW && !read_lease_blocks_accept(kv_ptr, (uint8_t) machine_id)) {
+    next->log_no = kv_ptr->last_committed_log_no + 1;
+    next->new_ts.version = version_outbidding_proposer_lease(kv_ptr, PAXOS_TS, next->log_no);
+    activate_kv_pair(PROPOSED, next->new_ts.version, kv_ptr, next->opcode,
+                     (uint8_t) machine_id, NULL, next->rmw_id.id,
+                     next->log_no, t_id,
+                     ENABLE_ASSERTIONS ? "hand_off_kv_ptr" : NULL);
+    kv_ptr_takes_priority(kv_ptr, next->priority);
+    next->base_ts = kv_ptr->ts;
+    kv_ptr_was_grabbed = true;
+  }
+  unlock_kv_ptr(kv_ptr, t_id);
+  if (!kv_ptr_was_grabbed) return;
+
+  pass_handoff_queue_to_next(loc_entry);
+  fill_loc_rmw_entry_on_grabbing_kv_ptr(next, next->new_ts.version,
+                                        PROPOSED, next->sess_id, t_id);
+  cp_prop_insert(cp_core_ctx->netw_ctx, next);
+  if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].handoffs++;
+}
+
+static inline void free_session_and_reinstate_loc_entry(cp_core_ctx_t *cp_core_ctx,
+                                                        loc_entry_t *loc_entry)
+{
+  sess_stall_t *stall_info = cp_core_ctx->stall_info;
+  uint16_t t_id = cp_core_ctx->t_id;
   switch(loc_entry->helping_flag)
   {
     case NOT_HELPING:
     case PROPOSE_NOT_LOCALLY_ACKED:
     case PROPOSE_LOCALLY_ACCEPTED:
+      hand_off_kv_ptr(cp_core_ctx, loc_entry);
       loc_entry->state = INVALID_RMW;
       free_session_from_rmw(loc_entry, stall_info, true, t_id);
       break;
@@ -293,10 +427,35 @@ inline void act_on_quorum_of_commit_acks(cp_core_ctx_t *cp_core_ctx,
   loc_entry_t *loc_entry = &cp_core_ctx->rmw_entries[sess_id];
   check_act_on_quorum_of_commit_acks(loc_entry);
 
-  if (loc_entry->helping_flag != HELP_PREV_COMMITTED_LOG_TOO_HIGH)
+  if (loc_entry->helping_flag != HELP_PREV_COMMITTED_LOG_TOO_HIGH) {
     commit_rmw(loc_entry->kv_ptr, NULL, loc_entry, FROM_LOCAL, cp_core_ctx->t_id);
+    confirm_read_lease(loc_entry, cp_core_ctx->t_id);
+  }
 
-  free_session_and_reinstate_loc_entry(cp_core_ctx->stall_info, loc_entry,cp_core_ctx->t_id);
+  free_session_and_reinstate_loc_entry(cp_core_ctx, loc_entry);
+}
+
+// LAZY_COMMITS: a propose or accept for log_no names the rmw committed in log_no - 1.
+// If that is the rmw this kv_ptr has accepted, commit it as if its commit without a value had arrived.
+// The kv_ptr must be locked
+inline void commit_rmw_implied_by_next_log(mica_op_t *kv_ptr,
+                                           uint64_t prev_rmw_id,
+                                           uint32_t log_no,
+                                           uint16_t t_id)
+{
+  if (!LAZY_COMMITS || prev_rmw_id == 0) return;
+  if (kv_ptr->state != ACCEPTED || kv_ptr->log_no + 1 != log_no ||
+      kv_ptr->last_committed_log_no + 1 != kv_ptr->log_no ||
+      kv_ptr->rmw_id.id != prev_rmw_id) return;
+
+  commit_info_t com_info;
+  ts_tuple_t base_ts = {0, 0};
+  fill_commit_info(&com_info, FROM_REMOTE_COMMIT_NO_VAL, prev_rmw_id,
+                   kv_ptr->log_no, base_ts, NULL, true);
+  com_info.no_value = true;
+  check_inputs_commit_algorithm(kv_ptr, &com_info, t_id);
+  commit_algorithm_on_locked_kv_ptr(kv_ptr, &com_info, t_id);
+  if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].implied_commits++;
 }
 
 inline void on_receiving_remote_commit(mica_op_t *kv_ptr,
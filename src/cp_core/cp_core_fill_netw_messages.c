@@ -4,6 +4,7 @@
 
 #include <cp_core_interface.h>
 #include <cp_core_common_util.h>
+#include <cp_stats.h>
 
 
 static inline void fill_com_with_no_val(cp_com_t *com,
@@ -22,14 +23,66 @@ static inline void fill_com_with_val(cp_com_t *com,
   com->opcode = COMMIT_OP;
   com->log_no = loc_entry->log_no;
   com->base_ts.version = loc_entry->base_ts.version;
-  if (broadcast_state == MUST_BCAST_COMMITS && !loc_entry->rmw_is_successful) {
-    memcpy(com->value, loc_entry->value_to_read, (size_t) RMW_VALUE_SIZE);
-  } else {
-    memcpy(com->value, loc_entry->value_to_write, (size_t) RMW_VALUE_SIZE);
-  }
+  memcpy(com->value,
+         staged_rmw_value(loc_entry, broadcast_state != MUST_BCAST_COMMITS),
+         (size_t) RMW_VALUE_SIZE);
   check_after_filling_com_with_val(com);
 }
 
+// The F&As and RMW operators with an 8-byte operand: they leave the value past their bytes
+// as they found it, so their commits can carry the operation and their accepts these bytes
+static inline bool rmw_op_is_shippable(loc_entry_t *loc_entry)
+{
+  if (loc_entry->opcode == FETCH_AND_ADD)
+    return loc_entry->rmw_val_len >= sizeof(uint64_t);
+  return opcode_is_rmw_operator(loc_entry->opcode) &&
+         (loc_entry->opcode != RMW_OP_BIT_OR || loc_entry->rmw_val_len <= sizeof(uint64_t));
+}
+
+// Only the RMWs of the session itself, and not to a machine known to miss the value the
+// operation is applied on: a helped RMW is known by its value alone
+static inline bool rmw_op_can_be_shipped(loc_entry_t *loc_entry,
+                                         uint8_t broadcast_state)
+{
+  if (!SHIP_RMW_OPS_IN_COMMITS || broadcast_state != MUST_BCAST_COMMITS ||
+      !loc_entry->ships_rmw_op) return false;
+  // the length travels in a byte
+  if (loc_entry->rmw_val_len > UINT8_MAX) return false;
+  // a partial-value RMW ships the bytes it changed
+  if (PARTIAL_VALUE_RMWS)
+    return loc_entry->rmw_val_len <= sizeof(uint64_t);
+  return rmw_op_is_shippable(loc_entry);
+}
+
+// The bytes an RMW has changed: an F&A adds to 8 bytes,
+// whatever the length the client reads back
+static inline uint32_t val_range_len(loc_entry_t *loc_entry)
+{
+  return loc_entry->opcode == FETCH_AND_ADD ?
+         MAX(loc_entry->rmw_val_len, sizeof(uint64_t)) : loc_entry->rmw_val_len;
+}
+
+static inline void fill_com_with_rmw_op(cp_com_t *com,
+                                        loc_entry_t *loc_entry,
+                                        uint16_t t_id)
+{
+  cp_com_delta_t *com_delta = (cp_com_delta_t *) com;
+  com_delta->opcode = COMMIT_DELTA_OP;
+  loc_entry->ships_rmw_op = false;
+  com_delta->rmw_opcode = loc_entry->opcode;
+  com_delta->val_len = (uint8_t) loc_entry->rmw_val_len;
+  com_delta->log_no = loc_entry->log_no;
+  com_delta->base_ts.version = loc_entry->base_ts.version;
+  com_delta->val_offset = loc_entry->val_offset;
+  if (PARTIAL_VALUE_RMWS) {
+    com_delta->val_len = (uint8_t) val_range_len(loc_entry);
+    com_delta->rmw_opcode = RMW_PLAIN_WRITE;
+    memcpy(com_delta->operand, loc_entry->value_to_write + loc_entry->val_offset,
+           com_delta->val_len);
+  }
+  else memcpy(com_delta->operand, &loc_entry->rmw_operand, sizeof(uint64_t));
+  if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].shipped_rmw_ops++;
+}
 
 inline uint16_t fill_commit_message_from_l_entry(cp_com_t *com,
                                                  void *loc_entry_ptr,
@@ -45,12 +98,49 @@ inline uint16_t fill_commit_message_from_l_entry(cp_com_t *com,
   if (loc_entry->avoid_val_in_com) {
     fill_com_with_no_val(com, loc_entry);
   }
+  else if (rmw_op_can_be_shipped(loc_entry, broadcast_state)) {
+    fill_com_with_rmw_op(com, loc_entry, t_id);
+  }
   else {
     fill_com_with_val(com, loc_entry, broadcast_state);
   }
   return loc_entry->sess_id;
 }
 
+#if LAZY_COMMITS
+// Tell the receivers which rmw committed in the previous log slot, so that a receiver
+// that has only accepted it can commit it without waiting for the deferred commit
+static inline uint64_t prev_committed_rmw_id(loc_entry_t *loc_entry)
+{
+  return loc_entry->prev_committed_log_no + 1 == loc_entry->log_no ?
+         loc_entry->prev_committed_rmw_id : 0;
+}
+#endif
+
+// The value of a helped RMW is all its helper knows of it. Once an accept of the RMW has been
+// nacked with LOG_TOO_HIGH, its accepts carry the whole value, for an acceptor that missed the base
+static inline bool acc_can_ship_val_range(loc_entry_t *loc_entry,
+                                          bool helping)
+{
+  if (helping || loc_entry->full_val_in_accs) return false;
+  if (!PARTIAL_VALUE_RMWS &&
+      !(SHIP_RMW_OPS_IN_COMMITS && rmw_op_is_shippable(loc_entry))) return false;
+  uint32_t len = val_range_len(loc_entry);
+  return len <= UINT8_MAX && ACC_RANGE_SIZE(len) < ACC_SIZE;
+}
+
+static inline void fill_acc_with_val_range(cp_acc_range_t *acc_range,
+                                           loc_entry_t *loc_entry,
+                                           uint16_t t_id)
+{
+  acc_range->opcode = ACCEPT_RANGE_OP;
+  acc_range->val_len = (uint8_t) val_range_len(loc_entry);
+  acc_range->val_offset = loc_entry->val_offset;
+  memcpy(acc_range->bytes, loc_entry->value_to_write + loc_entry->val_offset,
+         acc_range->val_len);
+  if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].acc_val_ranges++;
+}
+
 inline void cp_fill_acc(cp_acc_t *acc,
                         void *loc_entry_ptr,
                         bool helping,
@@ -72,11 +162,32 @@ inline void cp_fill_acc(cp_acc_t *acc,
   assign_ts_to_netw_ts(&acc->ts, &loc_entry->new_ts);
   memcpy(&acc->key, &loc_entry->key, KEY_SIZE);
   acc->opcode = ACCEPT_OP;
-  if (!helping && !loc_entry->rmw_is_successful)
-    memcpy(acc->value, loc_entry->value_to_read, (size_t) RMW_VALUE_SIZE);
-  else memcpy(acc->value, loc_entry->value_to_write, (size_t) RMW_VALUE_SIZE);
   acc->log_no = loc_entry->log_no;
   acc->val_len = (uint8_t) loc_entry->rmw_val_len;
+#if LAZY_COMMITS
+  acc->prev_rmw_id = helping ? 0 : prev_committed_rmw_id(loc_entry);
+#endif
+  if (acc_can_ship_val_range(loc_entry, helping))
+    fill_acc_with_val_range((cp_acc_range_t *) acc, loc_entry, t_id);
+  else memcpy(acc->value, staged_rmw_value(loc_entry, helping), (size_t) RMW_VALUE_SIZE);
+}
+
+static inline void fill_quorum_read(cp_prop_t *prop,
+                                    loc_entry_t *loc_entry)
+{
+  bool sums_stripes = STRIPED_COUNTERS && loc_entry->stripe_kv_ptrs != NULL;
+  memset(&prop->ts, 0, sizeof(prop->ts));
+  memcpy(&prop->key, sums_stripes ? &loc_entry->stripe_kv_ptrs[loc_entry->stripe]->key :
+                                    &loc_entry->key, KEY_SIZE);
+  prop->opcode = QUORUM_READ_OP;
+  prop->priority = 0;
+  prop->l_id = sums_stripes ? stripe_read_l_id(loc_entry, loc_entry->stripe) : loc_entry->l_id;
+  prop->t_rmw_id = 0;
+  prop->log_no = loc_entry->log_no;
+  prop->base_ts.version = DO_NOT_CHECK_BASE_TS;
+#if LAZY_COMMITS
+  prop->prev_rmw_id = 0;
+#endif
 }
 
 inline void cp_fill_prop(cp_prop_t *prop,
@@ -85,15 +196,23 @@ inline void cp_fill_prop(cp_prop_t *prop,
 {
   loc_entry_t *loc_entry = (loc_entry_t *) loc_entry_ptr;
   check_loc_entry_metadata_is_reset(loc_entry, "inserting prop", t_id);
+  if (loc_entry->state == QUORUM_READ) {
+    fill_quorum_read(prop, loc_entry);
+    return;
+  }
   assign_ts_to_netw_ts(&prop->ts, &loc_entry->new_ts);
   memcpy(&prop->key, (void *)&loc_entry->key, KEY_SIZE);
   prop->opcode = PROPOSE_OP;
+  prop->priority = loc_entry->priority;
   prop->l_id = loc_entry->l_id;
   prop->t_rmw_id = loc_entry->rmw_id.id;
   prop->log_no = loc_entry->log_no;
   if (!loc_entry->base_ts_found)
     prop->base_ts = loc_entry->base_ts;
   else prop->base_ts.version = DO_NOT_CHECK_BASE_TS;
+#if LAZY_COMMITS
+  prop->prev_rmw_id = prev_committed_rmw_id(loc_entry);
+#endif
   if (ENABLE_ASSERTIONS) {
     assert(prop->ts.version >= PAXOS_TS);
   }
@@ -4,6 +4,7 @@
 
 #include <cp_core_interface.h>
 #include <cp_core_common_util.h>
+#include <cp_stats.h>
 
 // Check the global RMW-id structure, to see if an RMW has already been committed
 static inline bool the_rmw_has_committed(mica_op_t *kv_ptr,
@@ -14,7 +15,7 @@ static inline bool the_rmw_has_committed(mica_op_t *kv_ptr,
   uint64_t glob_sess_id = rmw_id % GLOBAL_SESSION_NUM;
   check_the_rmw_has_committed(glob_sess_id);
 
-  if (committed_glob_sess_rmw_id[glob_sess_id] >= rmw_id) {
+  if (committed_glob_sess_rmw_id(glob_sess_id) >= rmw_id) {
     bool same_log = kv_ptr->last_committed_log_no == log_no;
     rep->opcode = (uint8_t) (same_log ? RMW_ID_COMMITTED_SAME_LOG : RMW_ID_COMMITTED);
     check_when_rmw_has_committed(kv_ptr, rep, glob_sess_id, log_no, rmw_id, t_id);
@@ -187,6 +188,65 @@ static inline uint8_t accept_snoops_entry(cp_acc_t *acc, mica_op_t *kv_ptr, uint
   return return_flag;
 }
 
+// Within a proposer lease, a ballot of another machine is nacked unless it outbids the lease,
+// which revokes it. The owner's accepts with the leased ballot have skipped the proposes,
+// so they are only safe where the lease has not been revoked
+static inline bool proposer_lease_nacks(mica_op_t *kv_ptr,
+                                        struct network_ts_tuple *ts,
+                                        uint32_t log_no,
+                                        bool is_prop,
+                                        cp_rmw_rep_t *rep)
+{
+  if (!PROPOSER_LEASE_SLOTS || log_no > kv_ptr->lease_end_log) return false;
+
+  compare_t lease_comp = compare_netw_ts_with_ts(ts, &kv_ptr->lease_ts);
+  bool nack;
+  if (ts->m_id == kv_ptr->lease_ts.m_id)
+    nack = !is_prop && lease_comp == EQUAL && kv_ptr->lease_revoked;
+  else if (kv_ptr->lease_revoked) nack = false;
+  else if (lease_comp == GREATER) {
+    kv_ptr->lease_revoked = true;
+    nack = false;
+  }
+  else nack = true;
+
+  if (nack) {
+    assign_ts_to_netw_ts(&rep->ts, &kv_ptr->lease_ts);
+    rep->opcode = SEEN_HIGHER_PROP;
+  }
+  return nack;
+}
+
+// Within the read lease promised to the designated replica of the key,
+// the accepts of every other machine are nacked until the promise runs out:
+// the nack tells the proposer how long to back off
+static inline bool read_lease_nacks(mica_op_t *kv_ptr,
+                                    uint8_t acc_m_id,
+                                    cp_rmw_rep_t *rep)
+{
+  if (!read_lease_blocks_accept(kv_ptr, acc_m_id)) return false;
+  assign_ts_to_netw_ts(&rep->ts, &kv_ptr->prop_ts);
+  rep->rmw_id = read_lease_ns_left(kv_ptr);
+  rep->opcode = READ_LEASE_NACK;
+  return true;
+}
+
+// A propose for the slot held by the proposal of an older RMW is nacked, so that
+// younger RMWs cannot keep outbidding it; it ages in turn every time it is nacked
+static inline bool older_rmw_nacks(mica_op_t *kv_ptr,
+                                   cp_prop_t *prop,
+                                   cp_rmw_rep_t *rep,
+                                   uint16_t t_id)
+{
+  if (prop->log_no != kv_ptr->log_no ||
+      kv_ptr->rmw_id.id == prop->t_rmw_id ||
+      !older_rmw_holds_kv_ptr(kv_ptr, prop->priority)) return false;
+  assign_ts_to_netw_ts(&rep->ts, &kv_ptr->prop_ts);
+  rep->opcode = SEEN_HIGHER_PROP;
+  if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].priority_deferrals++;
+  return true;
+}
+
 //Handle a remote propose/accept whose log number is big enough
 static inline uint8_t handle_remote_prop_or_acc_in_kvs(mica_op_t *kv_ptr, void *prop_or_acc,
                                                        uint8_t sender_m_id, uint16_t t_id,
@@ -214,7 +274,10 @@ static inline void bookkeeping_if_creating_prop_ack(cp_prop_t *prop,
     activate_kv_pair(PROPOSED, prop->ts.version, kv_ptr, prop->opcode,
                      prop->ts.m_id, NULL, prop->t_rmw_id, prop->log_no, t_id,
                      ENABLE_ASSERTIONS ? "received propose" : NULL);
+    kv_ptr_takes_priority(kv_ptr, prop->priority);
   }
+  else if (prop_rep->opcode == RMW_ACK_ACC_SAME_RMW)
+    grant_proposer_lease(kv_ptr, &kv_ptr->prop_ts, prop->log_no);
   if (prop_rep->opcode == RMW_ACK || prop_rep->opcode == RMW_ACK_ACC_SAME_RMW) {
     prop_rep->opcode = is_base_ts_too_small(kv_ptr, prop, prop_rep, t_id);
   }
@@ -228,9 +291,14 @@ static inline void create_prop_rep_after_locking_kv_ptr(cp_prop_t *prop,
                                                         uint64_t *number_of_reqs,
                                                         uint16_t t_id)
 {
+#if LAZY_COMMITS
+  commit_rmw_implied_by_next_log(kv_ptr, prop->prev_rmw_id, prop->log_no, t_id);
+#endif
   if (!is_log_lower_higher_or_has_rmw_committed(prop->log_no, kv_ptr,
                                                 prop->t_rmw_id,
-                                                t_id, prop_rep)) {
+                                                t_id, prop_rep) &&
+      !proposer_lease_nacks(kv_ptr, &prop->ts, prop->log_no, true, prop_rep) &&
+      !older_rmw_nacks(kv_ptr, prop, prop_rep, t_id)) {
     prop_rep->opcode = handle_remote_prop_or_acc_in_kvs(kv_ptr, (void *) prop, prop_mes->m_id, t_id,
                                                         prop_rep, prop->log_no, true);
     bookkeeping_if_creating_prop_ack(prop, prop_rep, kv_ptr, t_id);
@@ -238,6 +306,26 @@ static inline void create_prop_rep_after_locking_kv_ptr(cp_prop_t *prop,
   dbg_kv_ptr_create_acc_prop_rep(kv_ptr, number_of_reqs);
 }
 
+// Reads only: report the committed state of the key, and in the rmw_id the newest
+// log number that has an accepted but uncommitted value. The read of the designated
+// replica renews its read lease
+static inline void create_quorum_read_rep(cp_prop_t *prop,
+                                          cp_rmw_rep_t *rep,
+                                          mica_op_t *kv_ptr,
+                                          uint8_t prop_m_id,
+                                          uint16_t t_id)
+{
+  rep->l_id = prop->l_id;
+  rep->opcode = QUORUM_READ_REP;
+  lock_kv_ptr(kv_ptr, t_id);
+  promise_read_lease(kv_ptr, prop_m_id);
+  assign_ts_to_netw_ts(&rep->ts, &kv_ptr->ts);
+  memcpy(rep->value, kv_ptr->value, (size_t) RMW_VALUE_SIZE);
+  rep->log_no_or_base_version = kv_ptr->last_committed_log_no;
+  rep->rmw_id = newest_uncommitted_accepted_log_no(kv_ptr);
+  unlock_kv_ptr(kv_ptr, t_id);
+}
+
 inline void create_prop_rep(cp_prop_t *prop,
                             cp_prop_mes_t *prop_mes,
                             cp_rmw_rep_t *prop_rep,
@@ -245,6 +333,10 @@ inline void create_prop_rep(cp_prop_t *prop,
                             uint16_t t_id)
 {
   uint64_t number_of_reqs = 0;
+  if (prop->opcode == QUORUM_READ_OP) {
+    create_quorum_read_rep(prop, prop_rep, kv_ptr, prop_mes->m_id, t_id);
+    return;
+  }
 
   prop_rep->l_id = prop->l_id;
   lock_kv_ptr(kv_ptr, t_id);
@@ -256,6 +348,33 @@ inline void create_prop_rep(cp_prop_t *prop,
                         prop->ts, kv_ptr, number_of_reqs, false, t_id);
 }
 
+// An accept that carries only the bytes an RMW changed patches them into the value
+// they were taken from. An acceptor that does not hold that value nacks as if it had missed
+// its commit, and the proposer retries with a propose that finds the newest value
+static inline bool acc_range_misses_base_value(cp_acc_t *acc,
+                                               mica_op_t *kv_ptr,
+                                               uint16_t t_id,
+                                               cp_rmw_rep_t *rep)
+{
+  if (acc->opcode != ACCEPT_RANGE_OP ||
+      compare_ts(&kv_ptr->ts, &acc->base_ts) == EQUAL) return false;
+  log_no_too_high(acc->log_no, kv_ptr, t_id, rep);
+  if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].nacked_acc_val_ranges++;
+  return true;
+}
+
+static inline void store_accepted_value(mica_op_t *kv_ptr,
+                                        cp_acc_t *acc)
+{
+  if (acc->opcode == ACCEPT_RANGE_OP) {
+    cp_acc_range_t *acc_range = (cp_acc_range_t *) acc;
+    memcpy(kv_ptr->last_accepted_value, kv_ptr->value, (size_t) RMW_VALUE_SIZE);
+    memcpy(kv_ptr->last_accepted_value + acc_range->val_offset, acc_range->bytes,
+           acc_range->val_len);
+  }
+  else memcpy(kv_ptr->last_accepted_value, acc->value, (size_t) RMW_VALUE_SIZE);
+}
+
 static inline void create_acc_rep_after_locking_kv_ptr(cp_acc_t *acc,
                                                        cp_acc_mes_t *acc_mes,
                                                        cp_rmw_rep_t *acc_rep,
@@ -267,13 +386,19 @@ static inline void create_acc_rep_after_locking_kv_ptr(cp_acc_t *acc,
   //my_printf(cyan, "Received accept with rmw_id %u, glob_sess %u \n", rmw_l_id, glob_sess_id);
   uint32_t log_no = acc->log_no;
   uint8_t acc_m_id = acc_mes->m_id;
-  if (!is_log_lower_higher_or_has_rmw_committed(log_no, kv_ptr, rmw_l_id, t_id, acc_rep)) {
+#if LAZY_COMMITS
+  commit_rmw_implied_by_next_log(kv_ptr, acc->prev_rmw_id, log_no, t_id);
+#endif
+  if (!is_log_lower_higher_or_has_rmw_committed(log_no, kv_ptr, rmw_l_id, t_id, acc_rep) &&
+      !proposer_lease_nacks(kv_ptr, &acc->ts, log_no, false, acc_rep) &&
+      !read_lease_nacks(kv_ptr, acc_m_id, acc_rep) &&
+      !acc_range_misses_base_value(acc, kv_ptr, t_id, acc_rep)) {
     acc_rep->opcode = handle_remote_prop_or_acc_in_kvs(kv_ptr, (void *) acc, acc_m_id, t_id, acc_rep, log_no, false);
     if (acc_rep->opcode == RMW_ACK) {
       activate_kv_pair(ACCEPTED, acc->ts.version, kv_ptr, acc->opcode,
                        acc->ts.m_id, NULL, rmw_l_id, log_no, t_id,
                        ENABLE_ASSERTIONS ? "received accept" : NULL);
-      memcpy(kv_ptr->last_accepted_value, acc->value, (size_t) RMW_VALUE_SIZE);
+      store_accepted_value(kv_ptr, acc);
       kv_ptr->base_acc_ts = acc->base_ts;
     }
   }
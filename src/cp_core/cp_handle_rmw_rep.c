@@ -128,6 +128,15 @@ static inline void handle_rmw_rep_higher_acc_prop(cp_rmw_rep_t *rep,
   }
 }
 
+static inline void handle_rmw_rep_read_lease_nack(cp_rmw_rep_t *rep,
+                                                  rmw_rep_info_t *rep_info,
+                                                  bool is_accept,
+                                                  const uint16_t t_id)
+{
+  handle_rmw_rep_higher_acc_prop(rep, rep_info, is_accept, t_id);
+  rep_info->read_lease_wait_ns = MAX(rep_info->read_lease_wait_ns, rep->rmw_id);
+}
+
 static inline void handle_rmw_rep_log_too_high(rmw_rep_info_t *rep_info)
 {
   rep_info->log_too_high++;
@@ -160,6 +169,9 @@ static inline void handle_rmw_rep_based_on_opcode(cp_rmw_rep_mes_t *rep_mes,
     case SEEN_HIGHER_PROP:
       handle_rmw_rep_higher_acc_prop(rep, rep_info, is_accept, t_id);
       break;
+    case READ_LEASE_NACK:
+      handle_rmw_rep_read_lease_nack(rep, rep_info, is_accept, t_id);
+      break;
     case LOG_TOO_HIGH:
       handle_rmw_rep_log_too_high(rep_info);
       break;
@@ -181,14 +193,30 @@ static inline void handle_prop_or_acc_rep(cp_rmw_rep_mes_t *rep_mes,
   check_handle_rmw_rep_end(loc_entry, is_accept);
 }
 
+static inline void handle_quorum_read_rep(cp_rmw_rep_t *rep,
+                                          loc_entry_t *loc_entry)
+{
+  ts_tuple_t ts;
+  assign_netw_ts_to_ts(&ts, &rep->ts);
+  int stripe = stripe_of_read_l_id(loc_entry, rep->l_id);
+  if (stripe >= 0)
+    stripe_read_gathers_rep(loc_entry, (uint16_t) stripe, rep->log_no_or_base_version,
+                            &ts, rep->value);
+  else quorum_read_gathers_rep(loc_entry, rep->log_no_or_base_version, &ts,
+                               rep->value, (uint32_t) rep->rmw_id);
+}
+
 static inline int search_prop_entries_with_l_id(loc_entry_t * loc_entry_array,
                                                 uint8_t state,
                                                 uint64_t l_id)
 {
   uint16_t entry = (uint16_t) (l_id % SESSIONS_PER_THREAD);
   check_search_prop_entries_with_l_id(entry);
-  if (loc_entry_array[entry].state == state &&
-      loc_entry_array[entry].l_id == l_id)
+  loc_entry_t *loc_entry = &loc_entry_array[entry];
+  if (loc_entry->state != state) return -1;
+  // the quorum reads of the stripes of a counter each have their own l_id
+  if (loc_entry->l_id == l_id ||
+      (state == QUORUM_READ && stripe_of_read_l_id(loc_entry, l_id) >= 0))
     return entry;
   return -1; // i.e. l_id not found!!
 
@@ -205,11 +233,13 @@ static inline void find_local_and_handle_rmw_rep(loc_entry_t *loc_entry_array,
   check_find_local_and_handle_rmw_rep(loc_entry_array, rep, rep_mes,
                                       byte_ptr, is_accept, r_rep_i, t_id);
 
-  int entry_i = search_prop_entries_with_l_id(loc_entry_array, (uint8_t) (is_accept ? ACCEPTED : PROPOSED),
-                                              rep->l_id);
+  bool is_read = rep->opcode == QUORUM_READ_REP;
+  uint8_t state = (uint8_t) (is_accept ? ACCEPTED : (is_read ? QUORUM_READ : PROPOSED));
+  int entry_i = search_prop_entries_with_l_id(loc_entry_array, state, rep->l_id);
   if (entry_i == -1) return;
   loc_entry_t *loc_entry = &loc_entry_array[entry_i];
-  handle_prop_or_acc_rep(rep_mes, rep, loc_entry, is_accept, t_id);
+  if (is_read) handle_quorum_read_rep(rep, loc_entry);
+  else handle_prop_or_acc_rep(rep_mes, rep, loc_entry, is_accept, t_id);
 }
 
 // Handle read replies that refer to RMWs (either replies to accepts or proposes)
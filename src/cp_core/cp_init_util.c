@@ -6,6 +6,7 @@
 #include <cp_core_common_util.h>
 
 FILE* rmw_verify_fp[WORKERS_PER_MACHINE];
+uint8_t all_aboard_conflicts[WORKERS_PER_MACHINE][ALL_ABOARD_BUCKETS];
 
 void open_rmw_log_files(uint16_t t_id)
 {
@@ -34,6 +35,7 @@ loc_entry_t *cp_init_loc_entry(uint16_t t_id)
     loc_entry->help_loc_entry->helping_flag = IS_HELPER;
     loc_entry->help_loc_entry->glob_sess_id = loc_entry->glob_sess_id;
     loc_entry->state = INVALID_RMW;
+    loc_entry->back_off_rand = loc_entry->glob_sess_id * 2654435761U + 1;
   }
   return rmw_entries;
 }
@@ -50,5 +52,9 @@ cp_core_ctx_t* cp_init_cp_core_ctx(void *cp_ctx,
   cp_core_ctx->stall_info = stall_info;
   cp_core_ctx->netw_ctx = (void *) ctx;
   cp_core_ctx->t_id = t_id;
+#if LAZY_COMMITS
+  for (uint16_t i = 0; i < LAZY_COMMIT_BATCH; i++)
+    cp_core_ctx->lazy_coms[i].sess_id = LAZY_COMMIT_SESS;
+#endif
   return cp_core_ctx;
 }
@@ -5,6 +5,7 @@
 
 #include <cp_core_common_util.h>
 #include <cp_netw_interface.h>
+#include <cp_stats.h>
 
 
 static inline void zero_out_the_rmw_reply_loc_entry_metadata(loc_entry_t* loc_entry)
@@ -15,9 +16,67 @@ static inline void zero_out_the_rmw_reply_loc_entry_metadata(loc_entry_t* loc_en
 
   loc_entry->back_off_cntr = 0;
   if (ENABLE_ALL_ABOARD) loc_entry->all_aboard_time_out = 0;
+  if (THRIFTY_QUORUMS) {
+    loc_entry->thrifty_time_out = 0;
+    loc_entry->thrifty_sent = false;
+  }
   check_after_zeroing_out_rmw_reply(loc_entry);
 }
 
+/*
+ * ----THRIFTY QUORUMS----
+ **/
+
+static inline void widen_quorum_after_nacks(cp_core_ctx_t *cp_core_ctx,
+                                            loc_entry_t *loc_entry)
+{
+  if (THRIFTY_QUORUMS && loc_entry->rmw_reps.nacks > 0)
+    cp_widen_quorum(cp_core_ctx->netw_ctx);
+}
+
+inline void cp_core_round_sent_to_thrifty_quorum(cp_core_ctx_t *cp_core_ctx,
+                                                 uint64_t l_id)
+{
+  loc_entry_t *loc_entry = &cp_core_ctx->rmw_entries[l_id % SESSIONS_PER_THREAD];
+  bool is_stripe_read = loc_entry->state == QUORUM_READ && stripe_of_read_l_id(loc_entry, l_id) >= 0;
+  if (loc_entry->l_id == l_id || is_stripe_read) loc_entry->thrifty_sent = true;
+}
+
+// Only a round that has left for the thrifty quorum counts inspections towards its time-out:
+// one that is still in the send fifo, or went to all machines, can still gather its replies
+static inline bool thrifty_round_has_timed_out(loc_entry_t *loc_entry)
+{
+  if (!THRIFTY_QUORUMS || !loc_entry->thrifty_sent) return false;
+  loc_entry->thrifty_time_out++;
+  return loc_entry->thrifty_time_out >= THRIFTY_TIMEOUT_CNT;
+}
+
+// The round was sent to a quorum only and has not gathered its replies:
+// a machine of that quorum may be slow or down, so retry on all machines
+static inline void thrifty_round_times_out(cp_core_ctx_t *cp_core_ctx,
+                                           loc_entry_t *loc_entry)
+{
+  if (!thrifty_round_has_timed_out(loc_entry)) return;
+
+  cp_widen_quorum(cp_core_ctx->netw_ctx);
+  advance_loc_entry_l_id(loc_entry, cp_core_ctx->t_id); // late replies are dropped
+  loc_entry->help_loc_entry->state = INVALID_RMW;
+  memset(&loc_entry->rmw_reps, 0, sizeof(rmw_rep_info_t));
+  loc_entry->thrifty_time_out = 0;
+  loc_entry->thrifty_sent = false;
+  loc_entry->contended = true;
+  // an accept that helps another RMW gives up on it, like a nacked one;
+  // a propose that was about to help retries for the RMW of the entry
+  if (loc_entry->helping_flag == HELPING)
+    reinstate_loc_entry_after_helping(loc_entry, cp_core_ctx->t_id);
+  else {
+    if (loc_entry->helping_flag == PROPOSE_NOT_LOCALLY_ACKED ||
+        loc_entry->helping_flag == PROPOSE_LOCALLY_ACCEPTED)
+      loc_entry->helping_flag = NOT_HELPING;
+    loc_entry->state = RETRY_WITH_BIGGER_TS;
+  }
+}
+
 
 
 static inline bool set_up_broadcast_already_committed_if_needed(loc_entry_t *loc_entry)
@@ -61,12 +120,16 @@ static inline void prop_acc_handle_log_too_small(loc_entry_t *loc_entry)
 }
 
 
-static inline void prop_acc_handle_seen_higher_prop(loc_entry_t *loc_entry)
+static inline void prop_acc_handle_seen_higher_prop(loc_entry_t *loc_entry,
+                                                    uint16_t t_id)
 {
   check_if_accepted_cannot_be_helping(loc_entry);
   loc_entry->state = RETRY_WITH_BIGGER_TS;
   loc_entry->new_ts.version = loc_entry->rmw_reps.seen_higher_prop_version;
-
+  arm_retry_back_off(loc_entry);
+  wait_out_read_lease(loc_entry);
+  rmw_loses_a_round(loc_entry);
+  if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].nacked_retries++;
 }
 
 
@@ -108,23 +171,33 @@ static inline bool acc_help_is_nacked(loc_entry_t *loc_entry)
   return is_helping && received_a_nack;
 }
 
+// If every machine has accepted the value, every receiver of the commit can either take it
+// from its accepted state or has already committed it. Otherwise the commit of the session's
+// own RMW carries its operation, unless an acceptor has nacked with LOG_TOO_HIGH: that machine
+// misses the value the operation is applied on, and gets the whole value instead
 static inline void avoid_values_in_commits_if_possible(loc_entry_t *loc_entry)
 {
-  if (!ENABLE_COMMITS_WITH_NO_VAL) return;
-
-  if (loc_entry->rmw_reps.acks == MACHINE_NUM) {
+  rmw_rep_info_t *rep_info = &loc_entry->rmw_reps;
+  if (ENABLE_COMMITS_WITH_NO_VAL && rep_info->acks == MACHINE_NUM) {
     if (loc_entry->helping_flag == HELPING)
       loc_entry->help_loc_entry->avoid_val_in_com = true;
     else  loc_entry->avoid_val_in_com = true;
   }
+  else if (SHIP_RMW_OPS_IN_COMMITS && loc_entry->helping_flag != HELPING &&
+           rep_info->log_too_high == 0)
+    loc_entry->ships_rmw_op = true;
 }
 
-static inline void acc_handle_ack_quorum(loc_entry_t *loc_entry)
+static inline void acc_handle_ack_quorum(cp_core_ctx_t *cp_core_ctx,
+                                         loc_entry_t *loc_entry)
 {
   check_after_gathering_acc_acks(loc_entry);
   loc_entry->state = (uint8_t) (loc_entry->helping_flag == HELPING ?
                                 MUST_BCAST_COMMITS_FROM_HELP : MUST_BCAST_COMMITS);
   avoid_values_in_commits_if_possible(loc_entry);
+  bool completed_early = complete_rmw_at_accept_quorum(loc_entry, cp_core_ctx->stall_info,
+                                                       cp_core_ctx->t_id);
+  if (ENABLE_STAT_COUNTING && completed_early) cp_t_stats[cp_core_ctx->t_id].early_completions++;
 }
 
 
@@ -132,6 +205,8 @@ static inline void acc_handle_log_too_high(loc_entry_t *loc_entry)
 {
   //on an accept we do not try to commit the previous RMW
   loc_entry->state = RETRY_WITH_BIGGER_TS;
+  // an acceptor may have missed the value the changed bytes are patched into
+  loc_entry->full_val_in_accs = true;
 }
 
 static inline bool acc_handle_all_aboard(loc_entry_t *loc_entry,
@@ -171,9 +246,9 @@ static inline bool handle_quorum_of_acc_reps(cp_core_ctx_t *cp_core_ctx,
   else if (rep_info->log_too_small > 0)
     prop_acc_handle_log_too_small(loc_entry);
   else if (acc_has_received_ack_quorum(loc_entry))
-    acc_handle_ack_quorum(loc_entry);
+    acc_handle_ack_quorum(cp_core_ctx, loc_entry);
   else if (rep_info->seen_higher_prop_acc > 0)
-    prop_acc_handle_seen_higher_prop(loc_entry);
+    prop_acc_handle_seen_higher_prop(loc_entry, cp_core_ctx->t_id);
   else if (rep_info->log_too_high > 0)
     acc_handle_log_too_high(loc_entry);
   else return false;
@@ -187,6 +262,7 @@ static inline void inspect_accepts(cp_core_ctx_t *cp_core_ctx,
   check_inspect_accepts(loc_entry);
   loc_entry->rmw_reps.inspected = true;
 
+  widen_quorum_after_nacks(cp_core_ctx, loc_entry);
   bool was_quorum_of_answers_sufficient =
       handle_quorum_of_acc_reps(cp_core_ctx, loc_entry);
 
@@ -194,8 +270,10 @@ static inline void inspect_accepts(cp_core_ctx_t *cp_core_ctx,
   if (!was_quorum_of_answers_sufficient)
     need_to_wait_for_more_reps = acc_handle_all_aboard(loc_entry, cp_core_ctx->t_id);
 
-  if (!need_to_wait_for_more_reps)
+  if (!need_to_wait_for_more_reps) {
+    if (loc_entry->state != MUST_BCAST_COMMITS) loc_entry->contended = true;
     clean_up_after_inspecting_accept(loc_entry, cp_core_ctx->t_id);
+  }
 
 }
 
@@ -204,6 +282,7 @@ inline void inspect_accepts_if_ready_to_inspect(cp_core_ctx_t *cp_core_ctx,
 {
   if (loc_entry->rmw_reps.ready_to_inspect)
     inspect_accepts(cp_core_ctx, loc_entry);
+  else thrifty_round_times_out(cp_core_ctx, loc_entry);
 }
 
 
@@ -314,13 +393,17 @@ static inline void fill_help_loc_entry_to_bcast_after_log_too_high(loc_entry_t *
   loc_entry->help_loc_entry->key = loc_entry->key;
 }
 
+// A single LOG_TOO_HIGH nack is most often a commit still on its way to the nacker:
+// LOG_TOO_HIGH_PUSH pushes the previous commit only if the next propose is nacked too
 static inline void react_on_log_too_high_for_prop(loc_entry_t *loc_entry,
                                                   uint16_t t_id)
 {
   loc_entry->log_too_high_cntr++;
   bool time_out_expired = loc_entry->log_too_high_cntr == LOG_TOO_HIGH_TIME_OUT;
-  if (time_out_expired) {
-    print_log_too_high_timeout(loc_entry, t_id);
+  bool nacked_again = LOG_TOO_HIGH_PUSH && loc_entry->log_too_high_cntr > 1;
+  if (nacked_again || time_out_expired) {
+    if (time_out_expired) print_log_too_high_timeout(loc_entry, t_id);
+    else if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].log_too_high_pushes++;
     fill_help_loc_entry_to_bcast_after_log_too_high(loc_entry, t_id);
     loc_entry->log_too_high_cntr = 0;
   }
@@ -370,7 +453,7 @@ static inline bool handle_quorum_of_prop_reps(cp_core_ctx_t *cp_core_ctx,
   else if (rep_info->log_too_small > 0)
     prop_acc_handle_log_too_small(loc_entry);
   else if (rep_info->seen_higher_prop_acc > 0)
-    prop_acc_handle_seen_higher_prop(loc_entry);
+    prop_acc_handle_seen_higher_prop(loc_entry, cp_core_ctx->t_id);
   else if (prop_has_received_ack_quorum(loc_entry))
     prop_handle_ack_quorum(cp_core_ctx, loc_entry);
   else if (rep_info->already_accepted > 0)
@@ -391,7 +474,10 @@ static inline void inspect_proposes(cp_core_ctx_t *cp_core_ctx,
   advance_loc_entry_l_id(loc_entry, t_id);
 
   bool zero_out_log_too_high_cntr = true;
+  widen_quorum_after_nacks(cp_core_ctx, loc_entry);
   handle_quorum_of_prop_reps(cp_core_ctx, loc_entry, &zero_out_log_too_high_cntr);
+  if (loc_entry->state != ACCEPTED || loc_entry->helping_flag != NOT_HELPING)
+    loc_entry->contended = true;
   clean_up_after_inspecting_props(loc_entry, zero_out_log_too_high_cntr);
 }
 
@@ -401,4 +487,89 @@ inline void inspect_props_if_ready_to_inspect(cp_core_ctx_t *cp_core_ctx,
 {
   if (loc_entry->rmw_reps.ready_to_inspect)
     inspect_proposes(cp_core_ctx, loc_entry, cp_core_ctx->t_id);
-}
\ No newline at end of file
+  else thrifty_round_times_out(cp_core_ctx, loc_entry);
+}
+
+/*
+ * ----QUORUM READS----
+ **/
+
+static inline void complete_quorum_read(cp_core_ctx_t *cp_core_ctx,
+                                        loc_entry_t *loc_entry)
+{
+  complete_read_without_rmw(cp_core_ctx->stall_info, loc_entry->sess_id,
+                            loc_entry->index_to_req_array, loc_entry->value_to_read,
+                            cp_core_ctx->t_id);
+  loc_entry->state = INVALID_RMW;
+  if (ENABLE_STAT_COUNTING) cp_t_stats[cp_core_ctx->t_id].quorum_reads++;
+}
+
+// The replies do not agree, or a newer value may be chosen: linearize the read
+// through Paxos, as an F&A of 0
+static inline void quorum_read_falls_back_to_rmw(cp_core_ctx_t *cp_core_ctx,
+                                                 loc_entry_t *loc_entry)
+{
+  rearm_loc_entry_as_zero_fetch_and_add(loc_entry, cp_core_ctx->t_id);
+  if (ENABLE_STAT_COUNTING) cp_t_stats[cp_core_ctx->t_id].quorum_read_fallbacks++;
+}
+
+// STRIPED_COUNTERS: send together the quorum reads of the stripes that have yet to gather a quorum
+inline void send_counter_stripe_reads(cp_core_ctx_t *cp_core_ctx,
+                                      loc_entry_t *loc_entry)
+{
+  for (uint16_t stripe = 0; stripe < COUNTER_STRIPES; stripe++) {
+    if (loc_entry->stripe_reads[stripe].replies >= QUORUM_NUM) continue;
+    loc_entry->stripe = stripe;
+    cp_prop_insert(cp_core_ctx->netw_ctx, loc_entry);
+  }
+}
+
+// A stripe needs no decided read: an F&A completes only once committed, as EARLY_RMW_COMPLETION
+// is off with STRIPED_COUNTERS, so the newest value committed in a quorum counts every add
+// completed before the read, which is all the sum of the stripes can promise
+static inline void sum_counter_stripes(cp_core_ctx_t *cp_core_ctx,
+                                       loc_entry_t *loc_entry)
+{
+  uint64_t sum = 0;
+  for (uint16_t stripe = 0; stripe < COUNTER_STRIPES; stripe++)
+    sum += loc_entry->stripe_reads[stripe].counter;
+  memset(loc_entry->value_to_read, 0, (size_t) RMW_VALUE_SIZE);
+  memcpy(loc_entry->value_to_read, &sum, sizeof(uint64_t));
+  complete_quorum_read(cp_core_ctx, loc_entry);
+  if (ENABLE_STAT_COUNTING) cp_t_stats[cp_core_ctx->t_id].striped_reads++;
+}
+
+// The stripes whose reads timed out are read again from all machines
+static inline void read_counter_stripes_again(cp_core_ctx_t *cp_core_ctx,
+                                              loc_entry_t *loc_entry)
+{
+  rearm_loc_entry_for_striped_read(loc_entry, cp_core_ctx->t_id);
+  send_counter_stripe_reads(cp_core_ctx, loc_entry);
+  if (ENABLE_STAT_COUNTING)
+    cp_t_stats[cp_core_ctx->t_id].stripe_rereads += COUNTER_STRIPES - loc_entry->stripes_read;
+}
+
+inline void inspect_quorum_read_if_ready_to_inspect(cp_core_ctx_t *cp_core_ctx,
+                                                    loc_entry_t *loc_entry)
+{
+  bool sums_stripes = STRIPED_COUNTERS && loc_entry->stripe_kv_ptrs != NULL;
+  if (!loc_entry->rmw_reps.ready_to_inspect) {
+    if (!thrifty_round_has_timed_out(loc_entry)) return;
+    loc_entry->thrifty_time_out = 0;
+    loc_entry->thrifty_sent = false;
+    cp_widen_quorum(cp_core_ctx->netw_ctx);
+    advance_loc_entry_l_id(loc_entry, cp_core_ctx->t_id); // late replies are dropped
+    if (sums_stripes) read_counter_stripes_again(cp_core_ctx, loc_entry);
+    else quorum_read_falls_back_to_rmw(cp_core_ctx, loc_entry);
+    return;
+  }
+
+  advance_loc_entry_l_id(loc_entry, cp_core_ctx->t_id);
+  if (sums_stripes)
+    sum_counter_stripes(cp_core_ctx, loc_entry);
+  else if (quorum_read_is_decided(loc_entry)) {
+    confirm_read_lease_on_quorum_read(loc_entry, cp_core_ctx->t_id);
+    complete_quorum_read(cp_core_ctx, loc_entry);
+  }
+  else quorum_read_falls_back_to_rmw(cp_core_ctx, loc_entry);
+}
@@ -4,6 +4,7 @@
 
 #include <cp_core_common_util.h>
 #include <cp_core_interface.h>
+#include <cp_stats.h>
 
 static inline bool same_rmw_id_same_ts_and_invalid(mica_op_t *kv_ptr, loc_entry_t *loc_entry)
 {
@@ -44,8 +45,9 @@ static inline bool find_out_if_can_accept_help_locally(mica_op_t *kv_ptr,
                                       kv_ptr_is_invalid_but_not_committed,
                                       helping_stuck_accept, propose_locally_accepted, t_id);
 
-  return kv_ptr_is_the_same   || kv_ptr_is_invalid_but_not_committed ||
-         helping_stuck_accept || propose_locally_accepted;
+  return (kv_ptr_is_the_same   || kv_ptr_is_invalid_but_not_committed ||
+          helping_stuck_accept || propose_locally_accepted) &&
+         !read_lease_blocks_accept(kv_ptr, (uint8_t) machine_id);
 }
 
 static inline void take_kv_ptr_to_acc_state(mica_op_t *kv_ptr,
@@ -61,6 +63,10 @@ static inline void take_kv_ptr_to_acc_state(mica_op_t *kv_ptr,
   kv_ptr->base_acc_ts = kv_ptr->ts;
   kv_ptr->accepted_ts = loc_entry->new_ts;
   kv_ptr->accepted_log_no = kv_ptr->log_no;
+  promise_read_lease_on_local_accept(kv_ptr, loc_entry);
+  // a quorum has promised our ballot, and with it the lease
+  if (PROPOSER_LEASE_SLOTS && compare_ts(&kv_ptr->lease_ts, &loc_entry->new_ts) == EQUAL)
+    kv_ptr->lease_confirmed = true;
   checks_after_local_accept(kv_ptr, loc_entry, t_id);
 }
 
@@ -87,6 +93,7 @@ inline void attempt_local_accept(loc_entry_t *loc_entry,
   else { // the entry stores a different rmw_id and thus our proposal has been won by another
     checks_after_failure_to_locally_accept(kv_ptr, loc_entry, t_id);
     unlock_kv_ptr(loc_entry->kv_ptr, t_id);
+    rmw_loses_a_round(loc_entry);
     loc_entry->state = NEEDS_KV_PTR;
   }
 }
@@ -102,6 +109,7 @@ static inline void take_local_kv_ptr_to_acc_state_when_helping(mica_op_t *kv_ptr
   kv_ptr->accepted_log_no = kv_ptr->log_no;
   write_kv_ptr_acc_val(kv_ptr, help_loc_entry->value_to_write, (size_t) RMW_VALUE_SIZE);
   kv_ptr->base_acc_ts = help_loc_entry->base_ts;
+  promise_read_lease_on_local_accept(kv_ptr, loc_entry);
   checks_after_local_accept_help(kv_ptr, loc_entry, t_id);
   unlock_kv_ptr(loc_entry->kv_ptr, t_id);
   loc_entry->state = ACCEPTED;
@@ -141,23 +149,42 @@ inline void attempt_local_accept_to_help(loc_entry_t *loc_entry,
 }
 
 
+// Holding the lease, accept with the leased ballot; otherwise propose above any lease of another machine
+static inline void pick_version_for_invalid_kv_ptr(mica_op_t *kv_ptr,
+                                                   loc_entry_t *loc_entry,
+                                                   uint32_t *new_version,
+                                                   uint8_t *success_state)
+{
+  if (can_use_proposer_lease(kv_ptr, loc_entry)) {
+    *new_version = kv_ptr->lease_ts.version;
+    *success_state = ACCEPTED;
+    loc_entry->on_lease = true;
+  }
+  else if (*success_state == PROPOSED)
+    *new_version = version_outbidding_proposer_lease(kv_ptr, *new_version,
+                                                     kv_ptr->last_committed_log_no + 1);
+}
+
 static inline void rmw_fails_or_grabs_if_invalid_or_must_wait(trace_op_t *op,
                                                               mica_op_t *kv_ptr,
                                                               loc_entry_t *loc_entry,
-                                                              uint32_t new_version,
-                                                              uint8_t success_state,
+                                                              uint32_t *new_version,
+                                                              uint8_t *success_state,
                                                               uint16_t t_id)
 {
   check_trace_op_key_vs_kv_ptr(op, kv_ptr);
   if (does_rmw_fail_early(op, kv_ptr, t_id)) {
     loc_entry->state = CAS_FAILED;
   }
-  else if (kv_ptr->state == INVALID_RMW) {
-    activate_kv_pair(success_state, new_version, kv_ptr, op->opcode,
+  else if (kv_ptr->state == INVALID_RMW &&
+           !read_lease_blocks_accept(kv_ptr, (uint8_t) machine_id)) {
+    pick_version_for_invalid_kv_ptr(kv_ptr, loc_entry, new_version, success_state);
+    activate_kv_pair(*success_state, *new_version, kv_ptr, op->opcode,
                      (uint8_t) machine_id, loc_entry, loc_entry->rmw_id.id,
                      kv_ptr->last_committed_log_no + 1, t_id,
                      ENABLE_ASSERTIONS ? "batch to trace" : NULL);
-    loc_entry->state = success_state;
+    kv_ptr_takes_priority(kv_ptr, loc_entry->priority);
+    loc_entry->state = *success_state;
     loc_entry->log_no = kv_ptr->log_no;
   }
   else {
@@ -169,6 +196,19 @@ static inline void rmw_fails_or_grabs_if_invalid_or_must_wait(trace_op_t *op,
 }
 
 
+// The worker offers All-aboard when all machines are reachable; take it only if the key is not contended
+static inline void choose_between_all_aboard_and_classic(trace_op_t *op,
+                                                         mica_op_t *kv_ptr,
+                                                         uint16_t t_id)
+{
+  if (!ENABLE_ALL_ABOARD || !ADAPTIVE_ALL_ABOARD || !op->attempt_all_aboard) return;
+  op->attempt_all_aboard = all_aboard_is_likely_to_succeed(kv_ptr, t_id);
+  if (ENABLE_STAT_COUNTING) {
+    if (op->attempt_all_aboard) cp_t_stats[t_id].all_aboard_picks++;
+    else cp_t_stats[t_id].classic_picks++;
+  }
+}
+
 static inline void set_up_for_trying_rmw_trying_first_time(trace_op_t *op,
                                                            loc_entry_t *loc_entry,
                                                            uint32_t *new_version,
@@ -204,13 +244,77 @@ inline void rmw_tries_to_get_kv_ptr_first_time(trace_op_t *op,
   loc_entry_t *loc_entry = &cp_core_ctx->rmw_entries[op->session_id];
 
   uint32_t new_version; uint8_t success_state;
+  choose_between_all_aboard_and_classic(op, kv_ptr, t_id);
   set_up_for_trying_rmw_trying_first_time(op, loc_entry, &new_version, &success_state, t_id);
 
 
   lock_kv_ptr(kv_ptr, t_id);
-  rmw_fails_or_grabs_if_invalid_or_must_wait(op, kv_ptr, loc_entry, new_version,
-                                             success_state, t_id);
+  rmw_fails_or_grabs_if_invalid_or_must_wait(op, kv_ptr, loc_entry, &new_version,
+                                             &success_state, t_id);
   unlock_kv_ptr(kv_ptr, t_id);
 
   clean_up_for_trying_rmw_trying_first_time(op, kv_ptr, loc_entry, new_version);
 }
+
+inline void quorum_read_first_time(trace_op_t *op,
+                                   mica_op_t *kv_ptr,
+                                   cp_core_ctx_t *cp_core_ctx,
+                                   uint16_t t_id)
+{
+  loc_entry_t *loc_entry = &cp_core_ctx->rmw_entries[op->session_id];
+  check_when_init_loc_entry(loc_entry, op);
+  loc_entry->opcode = op->opcode;
+  loc_entry->stripe_kv_ptrs = op->stripe_kv_ptrs;
+  loc_entry->index_to_req_array = op->index_to_req_array;
+  loc_entry->rmw_val_len = op->real_val_len;
+  rearm_loc_entry_for_quorum_read(loc_entry, kv_ptr, t_id);
+  quorum_read_gathers_local_rep(loc_entry, kv_ptr, t_id);
+}
+
+// The local stripes count as the local replies of the quorum reads of all the stripes
+inline void striped_read_first_time(trace_op_t *op,
+                                    mica_op_t *kv_ptr,
+                                    cp_core_ctx_t *cp_core_ctx,
+                                    uint16_t t_id)
+{
+  if (ENABLE_ASSERTIONS) assert(op->stripe_kv_ptrs != NULL && op->stripe_kv_ptrs[0] == kv_ptr);
+  loc_entry_t *loc_entry = &cp_core_ctx->rmw_entries[op->session_id];
+  check_when_init_loc_entry(loc_entry, op);
+  loc_entry->opcode = op->opcode;
+  loc_entry->stripe_kv_ptrs = op->stripe_kv_ptrs;
+  loc_entry->index_to_req_array = op->index_to_req_array;
+  loc_entry->rmw_val_len = op->real_val_len;
+  memset(loc_entry->stripe_reads, 0, sizeof(loc_entry->stripe_reads));
+  loc_entry->stripes_read = 0;
+  rearm_loc_entry_for_striped_read(loc_entry, t_id);
+}
+
+// The designated replica serves the read from its kv_ptr while its read lease is valid. On a miss
+// it renews the lease with a quorum read, which takes no log slot; the other replicas read from a
+// quorum if they can, otherwise through an F&A of 0
+inline void read_tries_read_lease_first_time(trace_op_t *op,
+                                             mica_op_t *kv_ptr,
+                                             cp_core_ctx_t *cp_core_ctx,
+                                             uint16_t op_i,
+                                             uint16_t t_id)
+{
+  bool is_holder = is_read_lease_holder(kv_ptr, (uint8_t) machine_id);
+  if (is_holder) {
+    uint8_t value[RMW_VALUE_SIZE];
+    if (read_lease_serves_read(kv_ptr, value)) {
+      complete_read_without_rmw(cp_core_ctx->stall_info, op->session_id,
+                                op->index_to_req_array, value, t_id);
+      if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].read_lease_hits++;
+      return;
+    }
+    if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].read_lease_misses++;
+  }
+
+  if (ENABLE_QUORUM_READS || is_holder)
+    quorum_read_first_time(op, kv_ptr, cp_core_ctx, t_id);
+  else {
+    read_becomes_zero_fetch_and_add(op);
+    rmw_tries_to_get_kv_ptr_first_time(op, kv_ptr, cp_core_ctx, op_i, t_id);
+    cp_core_ctx->rmw_entries[op->session_id].serves_read = true;
+  }
+}
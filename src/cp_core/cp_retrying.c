@@ -59,9 +59,14 @@ static inline void update_loc_entry_when_taking_kv_ptr_with_higher_TS(mica_op_t
                                                                       loc_entry_t *loc_entry)
 {
   loc_entry->log_no = kv_ptr->last_committed_log_no + 1;
-  loc_entry->new_ts.version = MAX(loc_entry->new_ts.version, kv_ptr->prop_ts.version) + 1;
+  loc_entry->new_ts.version =
+      version_outbidding_proposer_lease(kv_ptr,
+                                        MAX(loc_entry->new_ts.version, kv_ptr->prop_ts.version) + 1,
+                                        loc_entry->log_no);
   loc_entry->base_ts = kv_ptr->ts; // Minimize the possibility for RMW_ACK_BASE_TS_STALE
   loc_entry->new_ts.m_id = (uint8_t) machine_id;
+  loc_entry->on_lease = false;
+  loc_entry_keeps_last_commit(kv_ptr, loc_entry);
 }
 
 static inline void update_kv_ptr_when_taking_kv_ptr_with_higher_TS(mica_op_t *kv_ptr,
@@ -73,6 +78,8 @@ static inline void update_kv_ptr_when_taking_kv_ptr_with_higher_TS(mica_op_t *kv
     assign_second_rmw_id_to_first(&kv_ptr->rmw_id, &loc_entry->rmw_id);
   }
   kv_ptr->prop_ts = loc_entry->new_ts;
+  kv_ptr_takes_priority(kv_ptr, loc_entry->priority);
+  grant_proposer_lease(kv_ptr, &loc_entry->new_ts, loc_entry->log_no);
 }
 
 static inline void if_accepted_help_else_steal(mica_op_t *kv_ptr,
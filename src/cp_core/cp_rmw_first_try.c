@@ -5,6 +5,7 @@
 #include <cp_core_interface.h>
 #include <cp_core_common_util.h>
 #include <cp_netw_interface.h>
+#include <cp_stats.h>
 
 
 
@@ -14,18 +15,24 @@ static inline void loc_entry_was_successful_first_time(loc_entry_t *loc_entry,
                                                        trace_op_t *op,
                                                        uint16_t t_id)
 {
+  bool on_lease = loc_entry->on_lease;
   fill_loc_rmw_entry_on_grabbing_kv_ptr(loc_entry, op->ts.version,
                                         loc_entry->state, op->session_id, t_id);
 
-  bool doing_all_aboard = loc_entry->state == ACCEPTED;
-  check_op_version(op, doing_all_aboard);
+  bool skips_proposes = loc_entry->state == ACCEPTED;
+  check_op_version(op, skips_proposes, on_lease);
 
-  if (doing_all_aboard) {
+  if (skips_proposes) {
     loc_entry->accepted_log_no = loc_entry->log_no;
     cp_acc_insert(cp_core_ctx->netw_ctx, loc_entry, false);
     loc_entry->killable = false;
-    loc_entry->all_aboard = true;
-    loc_entry->all_aboard_time_out = 0;
+    if (on_lease) {
+      if (ENABLE_STAT_COUNTING) cp_t_stats[t_id].leased_rmws++;
+    }
+    else {
+      loc_entry->all_aboard = true;
+      loc_entry->all_aboard_time_out = 0;
+    }
   }
   else
     cp_prop_insert(cp_core_ctx->netw_ctx, loc_entry);
@@ -55,12 +62,20 @@ inline void insert_rmw(cp_core_ctx_t *cp_core_ctx,
   uint16_t session_id = op->session_id;
   check_session_id(session_id);
   loc_entry_t *loc_entry = &cp_core_ctx->rmw_entries[session_id];
+  if (op->opcode == KVS_OP_GET) { // unless the read lease has already served it
+    if (loc_entry->state != QUORUM_READ) return;
+    if (STRIPED_COUNTERS && loc_entry->stripe_kv_ptrs != NULL)
+      send_counter_stripe_reads(cp_core_ctx, loc_entry);
+    else cp_prop_insert(cp_core_ctx->netw_ctx, loc_entry);
+    return;
+  }
   uint8_t success_state = (uint8_t) (ENABLE_ALL_ABOARD && op->attempt_all_aboard ? ACCEPTED : PROPOSED);
-  bool kv_ptr_taken = loc_entry->state == success_state;
+  bool kv_ptr_taken = loc_entry->state == success_state || loc_entry->on_lease;
 
   if (kv_ptr_taken)  loc_entry_was_successful_first_time(loc_entry, cp_core_ctx, op, t_id);
   else if (loc_entry->state == NEEDS_KV_PTR) {
     if (ENABLE_ALL_ABOARD) loc_entry->all_aboard = false;
+    loc_entry->contended = true;
   }
   else handle_loc_entry_cas_failed_first_time(loc_entry, cp_core_ctx, op, t_id);
 }
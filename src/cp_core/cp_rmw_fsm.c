@@ -5,13 +5,75 @@
 #include <cp_core_interface.h>
 #include <cp_core_common_util.h>
 #include <cp_netw_interface.h>
+#include <cp_stats.h>
 
 
 
 
+// LAZY_COMMITS: keep what the commit without a value needs and commit locally as if the
+// commit had been acked; the commit is broadcast later, unless the next propose or accept implies it
+static inline bool defer_commit(cp_core_ctx_t *cp_core_ctx,
+                                loc_entry_t* loc_entry)
+{
+#if LAZY_COMMITS
+  if (loc_entry->state != MUST_BCAST_COMMITS ||
+      !loc_entry->avoid_val_in_com ||
+      cp_core_ctx->lazy_com_num == LAZY_COMMIT_BATCH) return false;
+
+  loc_entry_t *lazy_com = &cp_core_ctx->lazy_coms[cp_core_ctx->lazy_com_num];
+  lazy_com->key = loc_entry->key;
+  lazy_com->rmw_id = loc_entry->rmw_id;
+  lazy_com->log_no = loc_entry->log_no;
+  lazy_com->base_ts = loc_entry->base_ts;
+  lazy_com->avoid_val_in_com = true;
+  if (cp_core_ctx->lazy_com_num == 0) cp_core_ctx->lazy_com_wait = 0;
+  cp_core_ctx->lazy_com_num++;
+
+  loc_entry->avoid_val_in_com = false;
+  loc_entry->state = COMMITTED;
+  act_on_quorum_of_commit_acks(cp_core_ctx, loc_entry->sess_id);
+  if (ENABLE_STAT_COUNTING) cp_t_stats[cp_core_ctx->t_id].lazy_commits++;
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Broadcast the deferred commits once the batch is full or the oldest has waited long enough;
+// those that find the com_rob full wait for the next inspection
+static inline void flush_lazy_commits(cp_core_ctx_t *cp_core_ctx)
+{
+#if LAZY_COMMITS
+  if (cp_core_ctx->lazy_com_num == 0) return;
+  cp_core_ctx->lazy_com_wait++;
+  if (cp_core_ctx->lazy_com_num < LAZY_COMMIT_BATCH &&
+      cp_core_ctx->lazy_com_wait < LAZY_COMMIT_TIMEOUT_CNT) return;
+
+  uint16_t flushed = 0;
+  while (flushed < cp_core_ctx->lazy_com_num &&
+         cp_com_insert(cp_core_ctx->netw_ctx, &cp_core_ctx->lazy_coms[flushed],
+                       MUST_BCAST_COMMITS))
+    flushed++;
+
+  uint16_t left = (uint16_t) (cp_core_ctx->lazy_com_num - flushed);
+  for (uint16_t i = 0; i < left; i++) {
+    loc_entry_t *lazy_com = &cp_core_ctx->lazy_coms[i];
+    loc_entry_t *unflushed = &cp_core_ctx->lazy_coms[flushed + i];
+    lazy_com->key = unflushed->key;
+    lazy_com->rmw_id = unflushed->rmw_id;
+    lazy_com->log_no = unflushed->log_no;
+    lazy_com->base_ts = unflushed->base_ts;
+    lazy_com->avoid_val_in_com = true;
+  }
+  cp_core_ctx->lazy_com_num = left;
+  if (ENABLE_STAT_COUNTING) cp_t_stats[cp_core_ctx->t_id].lazy_commit_flushes += flushed;
+#endif
+}
+
 static inline void inspect_commits(cp_core_ctx_t *cp_core_ctx,
                                    loc_entry_t* loc_entry)
 {
+  if (defer_commit(cp_core_ctx, loc_entry)) return;
 
   loc_entry_t *entry_to_commit =
       loc_entry->state == MUST_BCAST_COMMITS ? loc_entry : loc_entry->help_loc_entry;
@@ -26,6 +88,12 @@ static inline void inspect_commits(cp_core_ctx_t *cp_core_ctx,
 static inline void handle_retry_state(cp_core_ctx_t *cp_core_ctx,
                                       loc_entry_t* loc_entry)
 {
+  if (loc_entry->retry_back_off > 0) {
+    loc_entry->retry_back_off--;
+    if (ENABLE_STAT_COUNTING) cp_t_stats[cp_core_ctx->t_id].retry_back_off_waits++;
+    return;
+  }
+  if (waits_out_read_lease(loc_entry)) return;
   take_kv_ptr_with_higher_TS(cp_core_ctx->stall_info, loc_entry, false, cp_core_ctx->t_id);
   check_state_with_allowed_flags(5, (int) loc_entry->state,
                                  INVALID_RMW,
@@ -51,6 +119,9 @@ static inline void first_fsm_proped_acced_needs_kv(cp_core_ctx_t *cp_core_ctx,
     case NEEDS_KV_PTR:
       handle_needs_kv_ptr_state(cp_core_ctx, loc_entry, loc_entry->sess_id, cp_core_ctx->t_id);
       break;
+    case QUORUM_READ:
+      inspect_quorum_read_if_ready_to_inspect(cp_core_ctx, loc_entry);
+      break;
     default:
       break;
   }
@@ -85,4 +156,5 @@ inline void cp_core_inspect_rmws(cp_core_ctx_t *cp_core_ctx)
     check_when_inspecting_rmw(loc_entry, cp_core_ctx->stall_info, sess_i);
     rmw_fsms(cp_core_ctx, loc_entry);
   }
+  flush_lazy_commits(cp_core_ctx);
 }
\ No newline at end of file
@@ -34,7 +34,28 @@ inline void cp_KVS_batch_op_trace(uint16_t op_num,
         rmw_tries_to_get_kv_ptr_first_time(&op[op_i], kv_ptr[op_i],
                                            cp_ctx->cp_core_ctx, op_i, t_id);
         break;
-      default: if (ENABLE_ASSERTIONS) {
+      case KVS_OP_GET:
+        if (STRIPED_COUNTERS && op[op_i].stripe_kv_ptrs != NULL) {
+          striped_read_first_time(&op[op_i], kv_ptr[op_i], cp_ctx->cp_core_ctx, t_id);
+          break;
+        }
+        if (READ_LEASES) {
+          read_tries_read_lease_first_time(&op[op_i], kv_ptr[op_i], cp_ctx->cp_core_ctx, op_i, t_id);
+          break;
+        }
+        // the reads of keys that are not counters are quorum reads as well
+        if (ENABLE_QUORUM_READS || STRIPED_COUNTERS) {
+          quorum_read_first_time(&op[op_i], kv_ptr[op_i], cp_ctx->cp_core_ctx, t_id);
+          break;
+        }
+        // fall through
+      default:
+        if (opcode_is_rmw_operator(op[op_i].opcode)) {
+          rmw_tries_to_get_kv_ptr_first_time(&op[op_i], kv_ptr[op_i],
+                                             cp_ctx->cp_core_ctx, op_i, t_id);
+          break;
+        }
+        if (ENABLE_ASSERTIONS) {
           my_printf(red, "Wrkr %u: KVS_batch_op_trace wrong opcode in KVS: %d, req %d \n",
                     t_id, op[op_i].opcode, op_i);
           assert(false);
@@ -44,6 +65,47 @@ inline void cp_KVS_batch_op_trace(uint16_t op_num,
 }
 
 
+// Keys are hashed from their ids as the keys of the trace
+static inline mica_key_t key_of_key_id(uint32_t key_id)
+{
+  mica_key_t key;
+  uint128 key_hash = CityHash128((char *) &key_id, 4);
+  memcpy(&key, &key_hash.second, sizeof(mica_key_t));
+  return key;
+}
+
+// A session whose key is a stripe would corrupt the counter, so it works on the key
+// stripe_num ids below instead, which is never a stripe
+static inline void move_session_keys_off_stripe(cp_ctx_t *cp_ctx,
+                                                mica_key_t *stripe_key,
+                                                uint32_t key_id)
+{
+  for (uint16_t sess_i = 0; sess_i < SESSIONS_PER_THREAD; sess_i++)
+    if (keys_are_equal(&cp_ctx->key_per_sess[sess_i], stripe_key))
+      cp_ctx->key_per_sess[sess_i] = key_of_key_id(key_id - STRIPED_COUNTER_NUM * COUNTER_STRIPES);
+}
+
+// The stripes are the keys with the highest ids, to be called once the keys of the sessions are set
+void cp_KVS_locate_counter_stripes(cp_ctx_t *cp_ctx)
+{
+  uint32_t stripe_num = STRIPED_COUNTER_NUM * COUNTER_STRIPES;
+  uint32_t first_key_id = KVS_NUM_KEYS - stripe_num;
+  cp_ctx->counter_stripes = malloc(stripe_num * sizeof(mica_op_t *));
+  unsigned int bkt[1];
+  struct mica_bkt *bkt_ptr[1];
+  unsigned int tag[1];
+  mica_op_t *kv_ptr[1];
+  for (uint32_t stripe_i = 0; stripe_i < stripe_num; stripe_i++) {
+    mica_key_t key = key_of_key_id(first_key_id + stripe_i);
+    KVS_locate_one_bucket(0, bkt, &key, bkt_ptr, tag, kv_ptr, KVS);
+    KVS_locate_all_kv_pairs(1, tag, bkt_ptr, kv_ptr, KVS);
+    od_KVS_check_key(kv_ptr[0], key, 0);
+    cp_ctx->counter_stripes[stripe_i] = kv_ptr[0];
+    move_session_keys_off_stripe(cp_ctx, &key, first_key_id + stripe_i);
+  }
+}
+
+
 static inline void cp_KVS_batch_op_rmws(context_t *ctx, bool is_accept)
 {
   cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
@@ -122,7 +184,8 @@ inline void cp_KVS_batch_op_coms(context_t *ctx)
   for(op_i = 0; op_i < op_num; op_i++) {
     od_KVS_check_key(kv_ptr[op_i], coms[op_i]->key, op_i);
     cp_com_t *com = coms[op_i];
-    if (ENABLE_ASSERTIONS) assert(com->opcode == COMMIT_OP || com->opcode == COMMIT_OP_NO_VAL);
+    if (ENABLE_ASSERTIONS) assert(com->opcode == COMMIT_OP || com->opcode == COMMIT_OP_NO_VAL ||
+                                 com->opcode == COMMIT_RANGE_OP || com->opcode == COMMIT_DELTA_OP);
     on_receiving_remote_commit(kv_ptr[op_i], com, ptrs_to_com->ptr_to_mes[op_i], op_i, ctx->t_id);
   }
 }
\ No newline at end of file
@@ -5,7 +5,9 @@
 #include <cp_main_loop.h>
 #include <cp_netw_generic_util.h>
 #include <cp_netw_debug.h>
+#include <cp_netw_tuning.h>
 #include <cp_core_interface.h>
+#include <cp_stats.h>
 #include <cp_kvs.h>
 
 static inline void cp_apply_acks(context_t *ctx,
@@ -22,8 +24,10 @@ static inline void cp_apply_acks(context_t *ctx,
     com_rob->acks_seen++;
     cp_check_ack_and_print(ctx, com_rob, ack, ack_i, ack_ptr, ack_num);
     if (com_rob->acks_seen == REMOTE_QUORUM) {
-      act_on_quorum_of_commit_acks(cp_ctx->cp_core_ctx,
-                                   com_rob->sess_id);
+      // a flushed lazy commit has already been committed locally
+      if (com_rob->sess_id != LAZY_COMMIT_SESS)
+        act_on_quorum_of_commit_acks(cp_ctx->cp_core_ctx,
+                                     com_rob->sess_id);
       com_rob->state = READY_COMMIT;
     }
     MOD_INCR(ack_ptr, COM_ROB_SIZE);
@@ -35,7 +39,7 @@ static inline void increment_prop_acc_credits(context_t *ctx,
                                               cp_rmw_rep_mes_t *rep_mes,
                                               bool is_accept)
 {
-  ctx->qp_meta[is_accept ? ACC_QP_ID : PROP_QP_ID].credits[rep_mes->m_id]++;
+  cp_return_credits(ctx, is_accept ? ACC_QP_ID : PROP_QP_ID, rep_mes->m_id, 1);
 }
 
 static inline  void signal_in_progress_to_clts_when_filling(trace_op_t *op,
@@ -50,6 +54,49 @@ static inline  void signal_in_progress_to_clts_when_filling(trace_op_t *op,
 }
 
 
+// STRIPED_COUNTERS: every machine tells the counter keys apart by their hash alone
+static inline bool key_is_counter(mica_key_t *key)
+{
+  return key->tag % COUNTER_KEY_SHARE == 0;
+}
+
+// A counter key picks its counter; an F&A goes to the stripe of its session and
+// a read starts from the first stripe, carrying all of them to sum them
+static inline void stripe_counter_op(cp_ctx_t *cp_ctx,
+                                     trace_op_t *op,
+                                     int working_session,
+                                     uint16_t t_id)
+{
+  op->stripe_kv_ptrs = NULL;
+  if (!STRIPED_COUNTERS || !key_is_counter(&op->key)) return;
+  mica_op_t **stripes =
+    &cp_ctx->counter_stripes[(op->key.bkt % STRIPED_COUNTER_NUM) * COUNTER_STRIPES];
+  uint16_t stripe;
+  if (op->opcode == FETCH_AND_ADD)
+    stripe = (uint16_t) (get_glob_sess_id((uint8_t) machine_id, t_id,
+                                          (uint16_t) working_session) % COUNTER_STRIPES);
+  else if (op->opcode == KVS_OP_GET) {
+    stripe = 0;
+    op->stripe_kv_ptrs = stripes;
+  }
+  else return;
+  memcpy(&op->key, &stripes[stripe]->key, sizeof(mica_key_t));
+}
+
+// PARTIAL_VALUE_RMWS: the trace op works on one of the slots of its length in the value,
+// picked by the hash of its trace entry. A client request addresses the value from its start
+static inline uint16_t val_offset_of_trace_op(trace_op_t *op,
+                                              trace_t *trace)
+{
+  if (!PARTIAL_VALUE_RMWS || ENABLE_CLIENTS) return 0;
+  // an F&A adds to 8 bytes
+  uint32_t slot_len = op->opcode == FETCH_AND_ADD ?
+                      MAX(op->real_val_len, sizeof(uint64_t)) : op->real_val_len;
+  if (slot_len == 0 || slot_len >= RMW_VALUE_SIZE) return 0;
+  uint32_t slots = RMW_VALUE_SIZE / slot_len;
+  return (uint16_t) ((trace->key_hash[sizeof(trace->key_hash) - 1] % slots) * slot_len);
+}
+
 // Fill the trace_op to be passed to the KVS. Returns whether no more requests can be processed
 static inline bool fill_trace_op(context_t *ctx,
                                  cp_ctx_t *cp_ctx,
@@ -61,7 +108,9 @@ static inline bool fill_trace_op(context_t *ctx,
   create_inputs_of_op(&op->value_to_write, &op->value_to_read, &op->real_val_len,
                       &op->opcode, &op->index_to_req_array,
                       &op->key, op->value, trace, working_session, t_id);
+  op->val_offset = val_offset_of_trace_op(op, trace);
   memcpy(&op->key, &cp_ctx->key_per_sess[working_session], sizeof(mica_key_t));
+  stripe_counter_op(cp_ctx, op, working_session, t_id);
 
   if (!ENABLE_CLIENTS) check_trace_req(cp_ctx, trace, op, working_session, t_id);
 
@@ -69,7 +118,7 @@ static inline bool fill_trace_op(context_t *ctx,
   bool is_rmw = opcode_is_rmw(op->opcode);
   check_when_filling_op(cp_ctx, op, working_session, is_rmw);
   if (is_rmw && ENABLE_ALL_ABOARD) {
-    op->attempt_all_aboard = ctx->q_info->missing_num == 0;
+    op->attempt_all_aboard = ctx->q_info->missing_num == 0 && !THRIFTY_QUORUMS;
   }
   cp_ctx->stall_info.stalled[working_session] = true;
   op->session_id = (uint16_t) working_session;
@@ -140,17 +189,37 @@ static inline void batch_requests_to_KVS(context_t *ctx)
 
 inline void send_props_helper(context_t *ctx)
 {
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  cp_prop_mes_t *prop_mes = (cp_prop_mes_t *) get_fifo_pull_slot(ctx->qp_meta[PROP_QP_ID].send_fifo);
+  cp_rtt_mark_sent(&cp_ctx->rtt, prop_mes->l_id, false);
+  if (THRIFTY_QUORUMS && cp_ctx->thrifty.narrowed)
+    for (uint8_t i = 0; i < prop_mes->coalesce_num; i++)
+      cp_core_round_sent_to_thrifty_quorum(cp_ctx->cp_core_ctx, prop_mes->prop[i].l_id);
+  cp_count_sent_for_calibration(ctx, PROP_QP_ID);
   send_prop_checks(ctx);
 }
 
 inline void send_accs_helper(context_t *ctx)
 {
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  cp_acc_mes_t *acc_mes = (cp_acc_mes_t *) get_fifo_pull_slot(ctx->qp_meta[ACC_QP_ID].send_fifo);
+  cp_rtt_mark_sent(&cp_ctx->rtt, acc_mes->l_id, true);
+  if (THRIFTY_QUORUMS && cp_ctx->thrifty.narrowed) {
+    uint32_t byte_ptr = 0;
+    for (uint8_t i = 0; i < acc_mes->coalesce_num; i++) {
+      cp_acc_t *acc = (cp_acc_t *)(((void *) acc_mes->acc) + byte_ptr);
+      cp_core_round_sent_to_thrifty_quorum(cp_ctx->cp_core_ctx, acc->l_id);
+      byte_ptr += get_acc_size(acc);
+    }
+  }
+  cp_count_sent_for_calibration(ctx, ACC_QP_ID);
   send_acc_checks(ctx);
 }
 
 
 inline void cp_send_coms_helper(context_t *ctx)
 {
+  cp_count_sent_for_calibration(ctx, COM_QP_ID);
   send_com_checks(ctx);
 }
 
@@ -204,7 +273,7 @@ inline bool prop_recv_handler(context_t* ctx)
 
   for (uint16_t i = 0; i < coalesce_num; i++) {
     cp_prop_t *prop = &prop_mes->prop[i];
-    check_state_with_allowed_flags(2, prop->opcode, PROPOSE_OP);
+    check_state_with_allowed_flags(3, prop->opcode, PROPOSE_OP, QUORUM_READ_OP);
     fill_ptr_to_ops_for_reps(ptrs_to_prop, (void *) prop,
                              (void *) prop_mes, i);
   }
@@ -227,9 +296,12 @@ inline bool acc_recv_handler(context_t* ctx)
   cp_ptrs_to_ops_t *ptrs_to_acc = cp_ctx->ptrs_to_ops;
   if (qp_meta->polled_messages == 0) ptrs_to_acc->polled_ops = 0;
 
+  uint32_t byte_ptr = 0;
+  // accepts that carry a range of the value are shorter
   for (uint16_t i = 0; i < coalesce_num; i++) {
-    cp_acc_t *acc = &acc_mes->acc[i];
-    check_state_with_allowed_flags(2, acc->opcode, ACCEPT_OP);
+    cp_acc_t *acc = (cp_acc_t *)(((void *) acc_mes->acc) + byte_ptr);
+    check_state_with_allowed_flags(3, acc->opcode, ACCEPT_OP, ACCEPT_RANGE_OP);
+    byte_ptr += get_acc_size(acc);
     fill_ptr_to_ops_for_reps(ptrs_to_acc, (void *) acc,
                              (void *) acc_mes, i);
   }
@@ -248,6 +320,7 @@ inline bool cp_rmw_rep_recv_handler(context_t* ctx)
 
   bool is_accept = rep_mes->opcode == ACCEPT_REPLY;
   increment_prop_acc_credits(ctx, rep_mes, is_accept);
+  cp_rtt_on_rep(&cp_ctx->rtt, rep_mes, is_accept);
   handle_rmw_rep_replies(cp_ctx->cp_core_ctx, rep_mes, is_accept);
   return true;
 }
@@ -272,11 +345,13 @@ inline bool cp_rmw_rep_recv_handler(context_t* ctx)
   cp_ptrs_to_ops_t *ptrs_to_com = cp_ctx->ptrs_to_ops;
   if (qp_meta->polled_messages == 0) ptrs_to_com->polled_ops = 0;
   uint32_t byte_ptr = 0;
-  for (uint16_t i = 0; i < coalesce_num; i++) {
-    //cp_com_t *com = &com_mes->com[i];
+  // coalesce_num counts commits: a range entry stands for many
+  for (uint16_t i = 0; i < coalesce_num; ) {
     cp_com_t *com = (cp_com_t *)(((void *) com_mes->com) + byte_ptr);
-    byte_ptr += com->opcode == COMMIT_OP ? COM_SIZE : COMMIT_NO_VAL_SIZE ;
-    check_state_with_allowed_flags(3, com->opcode, COMMIT_OP, COMMIT_OP_NO_VAL);
+    check_state_with_allowed_flags(5, com->opcode, COMMIT_OP, COMMIT_OP_NO_VAL, COMMIT_RANGE_OP,
+                                   COMMIT_DELTA_OP);
+    byte_ptr += get_com_size(com);
+    i += get_com_commit_num(com);
     ptrs_to_com->ptr_to_ops[ptrs_to_com->polled_ops] = (void *) com;
     ptrs_to_com->ptr_to_mes[ptrs_to_com->polled_ops] = (void *) com_mes;
     ptrs_to_com->polled_ops++;
@@ -293,6 +368,7 @@ inline bool cp_ack_recv_handler(context_t *ctx)
   ctx_ack_mes_t *ack = (ctx_ack_mes_t *) &incoming_acks[recv_fifo->pull_ptr].ack;
 
   ctx_increase_credits_on_polling_ack(ctx, ACK_QP_ID, ack);
+  cp_absorb_credit_debt(ctx, COM_QP_ID, ack->m_id, ack->credits);
 
   if (od_is_ack_too_old(ack, cp_ctx->com_rob, cp_ctx->l_ids.applied_com_id))
     return true;
@@ -329,6 +405,55 @@ static inline void inspect_rmws(context_t *ctx)
 }
 
 
+/* ---------------------------------------------------------------------------
+//------------------------------ SEND SCHEDULING------------------------------
+//---------------------------------------------------------------------------*/
+
+static inline void cp_send_broadcasts(context_t *ctx,
+                                      uint16_t qp_id)
+{
+  cp_lend_credits_to_laggards(ctx, qp_id);
+  if (THRIFTY_QUORUMS && qp_id != COM_QP_ID)
+    cp_send_to_thrifty_quorum(ctx, qp_id);
+  else ctx_send_broadcasts(ctx, qp_id);
+}
+
+// There are messages waiting that cannot be broadcast, because some machine has not returned credits
+static inline bool qp_is_credit_starved(context_t *ctx,
+                                        uint16_t qp_id)
+{
+  per_qp_meta_t *qp_meta = &ctx->qp_meta[qp_id];
+  if (qp_meta->send_fifo->capacity == 0) return false;
+  for (uint8_t m_i = 0; m_i < MACHINE_NUM; m_i++) {
+    if (m_i == ctx->m_id || !cp_bcast_reaches(ctx, qp_id, m_i)) continue;
+    if (qp_meta->credits[m_i] == 0) return true;
+  }
+  return false;
+}
+
+// Messages that are closer to finishing an RMW go first: commits free sessions,
+// accepts are a round away from it, while proposes start new work. When commits or accepts
+// are stuck on credits, proposes are held back such that the remote machines are left to catch up
+static inline void cp_send_rmws_by_priority(context_t *ctx)
+{
+  cp_ctx_t *cp_ctx = (cp_ctx_t *) ctx->appl_ctx;
+  cp_send_sched_t *sched = &cp_ctx->sched;
+  cp_send_broadcasts(ctx, COM_QP_ID);
+  cp_send_broadcasts(ctx, ACC_QP_ID);
+
+  bool under_pressure = qp_is_credit_starved(ctx, COM_QP_ID) ||
+                        qp_is_credit_starved(ctx, ACC_QP_ID);
+  bool props_pending = ctx->qp_meta[PROP_QP_ID].send_fifo->capacity > 0;
+  if (under_pressure && props_pending &&
+      sched->deferred_prop_loops < PROP_STARVATION_LIMIT) {
+    sched->deferred_prop_loops++;
+    if (ENABLE_STAT_COUNTING) cp_t_stats[ctx->t_id].deferred_prop_loops++;
+    return;
+  }
+  sched->deferred_prop_loops = 0;
+  cp_send_broadcasts(ctx, PROP_QP_ID);
+}
+
 /* ---------------------------------------------------------------------------
 //------------------------------ COMMITTING-------------------------------------
 //---------------------------------------------------------------------------*/
@@ -341,12 +466,16 @@ _Noreturn void cp_main_loop(context_t *ctx)
   for (int i = 0; i < SESSIONS_PER_THREAD; i++){
     memcpy(&cp_ctx->key_per_sess[i], cp_ctx->trace_info.trace[i].key_hash, sizeof(mica_key_t));
   }
+  if (STRIPED_COUNTERS) cp_KVS_locate_counter_stripes(cp_ctx);
+  cp_start_credit_calibration(ctx);
   while(true) {
 
     cp_checks_at_loop_start(ctx);
+    cp_credit_calibration_step(ctx);
 
     batch_requests_to_KVS(ctx);
-    ctx_send_broadcasts(ctx, PROP_QP_ID);
+    if (!PRIORITY_SEND_SCHEDULING)
+      cp_send_broadcasts(ctx, PROP_QP_ID);
     for (uint16_t qp_i = 0; qp_i < QP_NUM; qp_i ++)
       ctx_poll_incoming_messages(ctx, qp_i);
 
@@ -355,8 +484,12 @@ _Noreturn void cp_main_loop(context_t *ctx)
     od_send_acks(ctx, ACK_QP_ID);
 
     inspect_rmws(ctx);
-    ctx_send_broadcasts(ctx, ACC_QP_ID);
-    ctx_send_broadcasts(ctx, COM_QP_ID);
+    if (PRIORITY_SEND_SCHEDULING)
+      cp_send_rmws_by_priority(ctx);
+    else {
+      cp_send_broadcasts(ctx, ACC_QP_ID);
+      cp_send_broadcasts(ctx, COM_QP_ID);
+    }
     cp_bookkeep_commits(ctx);
   }
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "cp_core_interface.h"
 #include "cp_netw_debug.h"
 #include <cp_netw_insert.h>
+#include <cp_stats.h>
 
 
 
@@ -98,6 +99,8 @@ inline void cp_insert_acc_help(context_t *ctx,
   cp_fill_acc(acc, source, (bool) source_flag, ctx->t_id);
 
   slot_meta_t *slot_meta = get_fifo_slot_meta_push(send_fifo);
+  if (acc->opcode == ACCEPT_RANGE_OP)
+    slot_meta->byte_size -= ACC_SIZE - get_acc_size(acc);
   cp_acc_mes_t *acc_mes = (cp_acc_mes_t *) get_fifo_push_slot(send_fifo);
   acc_mes->coalesce_num = (uint8_t) slot_meta->coalesce_num;
 
@@ -113,7 +116,7 @@ static inline void fill_com_rob_entry(cp_ctx_t *cp_ctx,
   cp_com_rob_t *com_rob = (cp_com_rob_t *) get_fifo_push_slot(cp_ctx->com_rob);
   if (ENABLE_ASSERTIONS) {
     assert(com_rob->state == INVALID);
-    assert(cp_ctx->stall_info.stalled[sess_id]);
+    assert(sess_id == LAZY_COMMIT_SESS || cp_ctx->stall_info.stalled[sess_id]);
   }
   com_rob->state = VALID;
   com_rob->sess_id = sess_id;
@@ -123,6 +126,40 @@ static inline void fill_com_rob_entry(cp_ctx_t *cp_ctx,
   fifo_increm_capacity(cp_ctx->com_rob);
 }
 
+static inline uint32_t last_log_of_com_entry(cp_com_t *com)
+{
+  return com->opcode == COMMIT_RANGE_OP ?
+         ((cp_com_range_t *) com)->first_log + ((cp_com_range_t *) com)->count - 1 :
+         com->log_no;
+}
+
+// If the previous entry of the message commits the previous log slot of the same key,
+// fold the new commit into it: receivers need only the last value, but every rmw-id.
+// The new commit has been written right after the previous entry, so the range grows over it.
+static inline bool extend_com_range(cp_ctx_t *cp_ctx,
+                                    cp_com_t *com)
+{
+  cp_com_t *prev = cp_ctx->last_com;
+  if (com->opcode != COMMIT_OP ||
+      prev->opcode == COMMIT_OP_NO_VAL || prev->opcode == COMMIT_DELTA_OP) return false;
+  if (last_log_of_com_entry(prev) + 1 != com->log_no) return false;
+  if (!keys_are_equal(&prev->key, &com->key)) return false;
+
+  cp_com_range_t *range = (cp_com_range_t *) prev;
+  if (ENABLE_ASSERTIONS)
+    assert((void *) com == (void *) prev + get_com_size(prev));
+  uint64_t rmw_id = com->t_rmw_id;
+  if (prev->opcode == COMMIT_OP) {
+    range->opcode = COMMIT_RANGE_OP;
+    range->count = 1;
+  }
+  range->base_ts = com->base_ts;
+  memcpy(range->value, com->value, (size_t) VALUE_SIZE);
+  range->t_rmw_ids[range->count - 1] = rmw_id;
+  range->count++;
+  return true;
+}
+
 inline void cp_insert_com_help(context_t *ctx,
                                void* com_ptr,
                                void *source,
@@ -136,8 +173,18 @@ inline void cp_insert_com_help(context_t *ctx,
       fill_commit_message_from_l_entry(com, source, source_flag, ctx->t_id);
 
   slot_meta_t *slot_meta = get_fifo_slot_meta_push(send_fifo);
-  if (com->opcode == COMMIT_OP_NO_VAL)
-    slot_meta->byte_size -= COM_SIZE - COMMIT_NO_VAL_SIZE;
+  if (ENABLE_COMMIT_RANGES && slot_meta->coalesce_num > 1 &&
+      extend_com_range(cp_ctx, com)) {
+    slot_meta->byte_size -= COM_SIZE - sizeof(uint64_t);
+    if (ENABLE_STAT_COUNTING) cp_t_stats[ctx->t_id].com_range_slots++;
+  }
+  else {
+    if (com->opcode == COMMIT_OP_NO_VAL)
+      slot_meta->byte_size -= COM_SIZE - COMMIT_NO_VAL_SIZE;
+    else if (com->opcode == COMMIT_DELTA_OP)
+      slot_meta->byte_size -= COM_SIZE - COM_DELTA_SIZE;
+    cp_ctx->last_com = com;
+  }
   cp_com_mes_t *com_mes = (cp_com_mes_t *) get_fifo_push_slot(send_fifo);
   com_mes->coalesce_num = (uint8_t) slot_meta->coalesce_num;
 
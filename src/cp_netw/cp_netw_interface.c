@@ -6,6 +6,17 @@
 #include <od_netw_func.h>
 #include <cp_netw_structs.h>
 #include <cp_messages.h>
+#include <cp_netw_generic_util.h>
+#include <cp_netw_tuning.h>
+
+// Close the message being built once it holds as many entries as the runtime coalescing allows
+static inline bool cp_must_break_message(context_t *ctx,
+                                         uint16_t qp_id,
+                                         uint16_t coalesce)
+{
+  fifo_t *send_fifo = ctx->qp_meta[qp_id].send_fifo;
+  return get_fifo_slot_meta_push(send_fifo)->coalesce_num >= coalesce;
+}
 
 
 inline void cp_rmw_rep_insert(void *ctx,
@@ -33,7 +44,8 @@ inline void cp_prop_insert(void *ctx,
   od_insert_mes((context_t *) ctx, PROP_QP_ID,
                 (uint32_t) PROP_SIZE,
                 PROP_REP_SIZE,
-                false, loc_entry,
+                cp_must_break_message((context_t *) ctx, PROP_QP_ID, cp_params.prop_coalesce),
+                loc_entry,
                 0, 0);
 }
 
@@ -44,7 +56,8 @@ inline void cp_acc_insert(void *ctx,
   od_insert_mes((context_t*) ctx, ACC_QP_ID,
                 (uint32_t) ACC_SIZE,
                 ACC_REP_MES_SIZE,
-                false, loc_entry,
+                cp_must_break_message((context_t *) ctx, ACC_QP_ID, cp_params.acc_coalesce),
+                loc_entry,
                 helping, 0);
 }
 
@@ -58,9 +71,17 @@ inline bool cp_com_insert(void *ctx,
     od_insert_mes(od_ctx, COM_QP_ID,
                   (uint32_t) COM_SIZE,
                   1,
-                  false, loc_entry,
+                  cp_must_break_message(od_ctx, COM_QP_ID, cp_params.com_coalesce),
+                  loc_entry,
                   state, 0);
     return true;
   }
   else return false;
-}
\ No newline at end of file
+}
+
+inline void cp_widen_quorum(void *ctx)
+{
+  context_t *od_ctx = (context_t *) ctx;
+  cp_widen_thrifty_quorum((cp_ctx_t *) od_ctx->appl_ctx);
+  if (ENABLE_STAT_COUNTING) cp_t_stats[od_ctx->t_id].quorum_widenings++;
+}
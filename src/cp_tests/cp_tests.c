@@ -0,0 +1,554 @@
+//
+// Unit checks for the commit algorithm, the inspection of replies and the RMW helpers that need no network.
+// The sources are included so that their static inline functions are in scope
+//
+
+#include "../cp_core/cp_commit_alg.c"
+#include "../cp_core/cp_inspect_props_accs.c"
+#include "../cp_core/cp_core_fill_netw_messages.c"
+#include "../cp_core/cp_handle_remote_rmw.c"
+
+cp_stats_t cp_t_stats[WORKERS_PER_MACHINE];
+committed_rmw_id_slot_t committed_rmw_id_registry[GLOBAL_SESSION_NUM];
+
+#define T_ID 0
+#define RMW_ID(glob_sess_id, n) ((uint64_t) (n) * GLOBAL_SESSION_NUM + (glob_sess_id))
+
+static int checks_run = 0;
+
+#define CHECK(cond) do {                                                  \
+    checks_run++;                                                         \
+    if (!(cond)) {                                                        \
+      printf("%s:%d: check failed: %s \n", __FILE__, __LINE__, #cond);  \
+      exit(1);                                                            \
+    }                                                                     \
+  } while (0)
+
+/* ---------------------------------------------------------------------------
+//------------------------------ FIXTURES ------------------------------------
+//---------------------------------------------------------------------------*/
+
+static void reset_registry(void)
+{
+  memset(committed_rmw_id_registry, 0, sizeof(committed_rmw_id_registry));
+}
+
+// A kv_ptr that has committed log_no with value val
+static void init_kv_ptr(mica_op_t *kv_ptr, uint32_t log_no, uint64_t val)
+{
+  memset(kv_ptr, 0, sizeof(mica_op_t));
+  kv_ptr->state = INVALID_RMW;
+  kv_ptr->log_no = log_no;
+  kv_ptr->last_committed_log_no = log_no;
+  kv_ptr->ts.version = 2;
+  memcpy(kv_ptr->value, &val, sizeof(uint64_t));
+}
+
+// The kv_ptr accepts rmw_id for log_no with value val
+static void kv_ptr_accepts(mica_op_t *kv_ptr, uint64_t rmw_id, uint32_t log_no, uint64_t val)
+{
+  kv_ptr->state = ACCEPTED;
+  kv_ptr->log_no = log_no;
+  kv_ptr->accepted_log_no = log_no;
+  kv_ptr->rmw_id.id = rmw_id;
+  kv_ptr->accepted_rmw_id.id = rmw_id;
+  kv_ptr->base_acc_ts = kv_ptr->ts;
+  kv_ptr->base_acc_ts.version += 2;
+  memcpy(kv_ptr->last_accepted_value, &val, sizeof(uint64_t));
+}
+
+static uint64_t kv_ptr_val(mica_op_t *kv_ptr)
+{
+  uint64_t val;
+  memcpy(&val, kv_ptr->value, sizeof(uint64_t));
+  return val;
+}
+
+static void commit_no_val(mica_op_t *kv_ptr, uint64_t rmw_id, uint32_t log_no)
+{
+  cp_com_no_val_t com_no_val;
+  memset(&com_no_val, 0, sizeof(com_no_val));
+  com_no_val.opcode = COMMIT_OP_NO_VAL;
+  com_no_val.t_rmw_id = rmw_id;
+  com_no_val.log_no = log_no;
+  commit_rmw(kv_ptr, (void *) &com_no_val, NULL, FROM_REMOTE_COMMIT, T_ID);
+}
+
+/* ---------------------------------------------------------------------------
+//------------------------------ COMMITS WITHOUT A VALUE ---------------------
+//---------------------------------------------------------------------------*/
+
+static void test_com_no_val_takes_accepted_value(void)
+{
+  mica_op_t kv_ptr;
+  reset_registry();
+  init_kv_ptr(&kv_ptr, 4, 10);
+  kv_ptr_accepts(&kv_ptr, RMW_ID(3, 1), 5, 11);
+
+  commit_no_val(&kv_ptr, RMW_ID(3, 1), 5);
+  CHECK(kv_ptr.last_committed_log_no == 5);
+  CHECK(kv_ptr.last_committed_rmw_id.id == RMW_ID(3, 1));
+  CHECK(kv_ptr.state == INVALID_RMW);
+  CHECK(kv_ptr_val(&kv_ptr) == 11);
+  CHECK(committed_glob_sess_rmw_id(3) == RMW_ID(3, 1));
+}
+
+// The kv_ptr has accepted another RMW for the same log: it must not commit that value
+static void test_com_no_val_dropped_on_other_rmw_id(void)
+{
+  mica_op_t kv_ptr;
+  reset_registry();
+  init_kv_ptr(&kv_ptr, 4, 10);
+  kv_ptr_accepts(&kv_ptr, RMW_ID(2, 1), 5, 12);
+
+  commit_no_val(&kv_ptr, RMW_ID(3, 1), 5);
+  CHECK(kv_ptr.last_committed_log_no == 4);
+  CHECK(kv_ptr.state == ACCEPTED);
+  CHECK(kv_ptr_val(&kv_ptr) == 10);
+  CHECK(committed_glob_sess_rmw_id(3) == 0);
+}
+
+// The kv_ptr has not accepted anything for the log: the value it holds is of an older log
+static void test_com_no_val_dropped_on_other_log(void)
+{
+  mica_op_t kv_ptr;
+  reset_registry();
+  init_kv_ptr(&kv_ptr, 4, 10);
+  kv_ptr_accepts(&kv_ptr, RMW_ID(3, 1), 4, 10);
+  kv_ptr.state = INVALID_RMW;
+
+  commit_no_val(&kv_ptr, RMW_ID(3, 1), 5);
+  CHECK(kv_ptr.last_committed_log_no == 4);
+  CHECK(kv_ptr_val(&kv_ptr) == 10);
+  CHECK(committed_glob_sess_rmw_id(3) == 0);
+
+  // a commit for a log further ahead is dropped as well
+  commit_no_val(&kv_ptr, RMW_ID(3, 1), 6);
+  CHECK(kv_ptr.last_committed_log_no == 4);
+  CHECK(committed_glob_sess_rmw_id(3) == 0);
+}
+
+// The log has been committed already, the commit is only registered
+static void test_com_no_val_on_committed_log(void)
+{
+  mica_op_t kv_ptr;
+  reset_registry();
+  init_kv_ptr(&kv_ptr, 4, 10);
+  kv_ptr.last_committed_rmw_id.id = RMW_ID(3, 1);
+
+  commit_no_val(&kv_ptr, RMW_ID(3, 1), 4);
+  CHECK(kv_ptr.last_committed_log_no == 4);
+  CHECK(kv_ptr_val(&kv_ptr) == 10);
+  CHECK(committed_glob_sess_rmw_id(3) == RMW_ID(3, 1));
+}
+
+/* ---------------------------------------------------------------------------
+//------------------------------ SHIPPED RMW OPERATIONS ----------------------
+//---------------------------------------------------------------------------*/
+
+static void test_apply_shipped_rmw_op(void)
+{
+  uint64_t value[2] = {40, 0};
+  uint64_t operand[2] = {2, 0};
+
+  CHECK(apply_shipped_rmw_op(FETCH_AND_ADD, (uint8_t *) value, (uint8_t *) operand, 8));
+  CHECK(value[0] == 42);
+
+  operand[0] = 41;
+  CHECK(!apply_shipped_rmw_op(RMW_OP_MAX, (uint8_t *) value, (uint8_t *) operand, 8));
+  CHECK(value[0] == 42);
+  operand[0] = 50;
+  CHECK(apply_shipped_rmw_op(RMW_OP_MAX, (uint8_t *) value, (uint8_t *) operand, 8));
+  CHECK(value[0] == 50);
+
+  operand[0] = 7;
+  CHECK(apply_shipped_rmw_op(RMW_PLAIN_WRITE, (uint8_t *) &value[1], (uint8_t *) operand, 8));
+  CHECK(value[0] == 50 && value[1] == 7);
+}
+
+// The counter operators need the 8 bytes of the counter, and read it unaligned
+static void test_rmw_operators_on_short_values(void)
+{
+  uint8_t value[17] = {0};
+  uint64_t operand = 9, too_much = 10, counter = 5;
+  memcpy(&value[1], &counter, sizeof(uint64_t));
+
+  CHECK(!rmw_op_max(&value[1], (uint8_t *) &operand, 4));
+  CHECK(!rmw_op_min(&value[1], (uint8_t *) &operand, 7));
+  CHECK(!rmw_op_bounded_dec(&value[1], (uint8_t *) &operand, 0));
+  memcpy(&counter, &value[1], sizeof(uint64_t));
+  CHECK(counter == 5);
+
+  CHECK(rmw_op_max(&value[1], (uint8_t *) &operand, 8));
+  memcpy(&counter, &value[1], sizeof(uint64_t));
+  CHECK(counter == 9);
+  CHECK(!rmw_op_bounded_dec(&value[1], (uint8_t *) &too_much, 8));
+  CHECK(rmw_op_bounded_dec(&value[1], (uint8_t *) &operand, 8));
+  memcpy(&counter, &value[1], sizeof(uint64_t));
+  CHECK(counter == 0);
+
+  // one item fits in 16 bytes next to the count, a second one does not
+  CHECK(!rmw_op_append(&value[1], (uint8_t *) &operand, 7));
+  CHECK(rmw_op_append(&value[1], (uint8_t *) &operand, 16));
+  memcpy(&counter, &value[9], sizeof(uint64_t));
+  CHECK(value[1] == 1 && counter == 9);
+  CHECK(!rmw_op_append(&value[1], (uint8_t *) &operand, 16));
+}
+
+// A commit of the session's own RMW carries its operation unless it can go without a value,
+// or an acceptor has nacked with LOG_TOO_HIGH, missing the value the operation is applied on
+static void test_commit_ships_rmw_op_unless_base_is_missed(void)
+{
+  loc_entry_t loc_entry;
+  memset(&loc_entry, 0, sizeof(loc_entry_t));
+  loc_entry.helping_flag = NOT_HELPING;
+  loc_entry.rmw_reps.acks = QUORUM_NUM;
+  avoid_values_in_commits_if_possible(&loc_entry);
+  CHECK(loc_entry.ships_rmw_op == SHIP_RMW_OPS_IN_COMMITS && !loc_entry.avoid_val_in_com);
+
+  loc_entry.ships_rmw_op = false;
+  loc_entry.rmw_reps.log_too_high = 1;
+  avoid_values_in_commits_if_possible(&loc_entry);
+  CHECK(!loc_entry.ships_rmw_op && !loc_entry.avoid_val_in_com);
+
+  loc_entry.rmw_reps.log_too_high = 0;
+  loc_entry.rmw_reps.acks = MACHINE_NUM;
+  avoid_values_in_commits_if_possible(&loc_entry);
+  CHECK(loc_entry.avoid_val_in_com == ENABLE_COMMITS_WITH_NO_VAL);
+  CHECK(loc_entry.ships_rmw_op == (SHIP_RMW_OPS_IN_COMMITS && !ENABLE_COMMITS_WITH_NO_VAL));
+}
+
+// An accept that carries only the changed bytes patches them into the committed value it was
+// taken from. An acceptor whose value has another ts nacks with LOG_TOO_HIGH
+static void test_acc_range_patches_base_value(void)
+{
+  mica_op_t kv_ptr;
+  init_kv_ptr(&kv_ptr, 4, 10);
+  kv_ptr.value[sizeof(uint64_t)] = 7; // a byte the RMW does not change
+  uint8_t acc_buf[ACC_SIZE];
+  memset(acc_buf, 0, ACC_SIZE);
+  cp_acc_range_t *acc_range = (cp_acc_range_t *) acc_buf;
+  acc_range->opcode = ACCEPT_RANGE_OP;
+  acc_range->log_no = 5;
+  acc_range->val_len = sizeof(uint64_t);
+  acc_range->base_ts = kv_ptr.ts;
+  uint64_t new_val = 11;
+  memcpy(acc_range->bytes, &new_val, sizeof(uint64_t));
+
+  cp_rmw_rep_t acc_rep;
+  memset(&acc_rep, 0, sizeof(cp_rmw_rep_t));
+  CHECK(!acc_range_misses_base_value((cp_acc_t *) acc_range, &kv_ptr, T_ID, &acc_rep));
+  store_accepted_value(&kv_ptr, (cp_acc_t *) acc_range);
+  uint64_t acc_val;
+  memcpy(&acc_val, kv_ptr.last_accepted_value, sizeof(uint64_t));
+  CHECK(acc_val == 11 && kv_ptr.last_accepted_value[sizeof(uint64_t)] == 7);
+
+  acc_range->base_ts.version += 2;
+  CHECK(acc_range_misses_base_value((cp_acc_t *) acc_range, &kv_ptr, T_ID, &acc_rep));
+  CHECK(acc_rep.opcode == LOG_TOO_HIGH);
+}
+
+// Once an accept of the RMW has been nacked with LOG_TOO_HIGH, its accepts carry the whole value
+static void test_nacked_acc_carries_whole_value(void)
+{
+  loc_entry_t loc_entry;
+  memset(&loc_entry, 0, sizeof(loc_entry_t));
+  loc_entry.opcode = FETCH_AND_ADD;
+  loc_entry.rmw_val_len = sizeof(uint64_t);
+  CHECK(acc_can_ship_val_range(&loc_entry, false) == (PARTIAL_VALUE_RMWS || SHIP_RMW_OPS_IN_COMMITS));
+  CHECK(!acc_can_ship_val_range(&loc_entry, true));
+
+  acc_handle_log_too_high(&loc_entry);
+  CHECK(loc_entry.state == RETRY_WITH_BIGGER_TS);
+  CHECK(!acc_can_ship_val_range(&loc_entry, false));
+}
+
+static void commit_delta(mica_op_t *kv_ptr, uint64_t rmw_id, uint32_t log_no, uint64_t addend)
+{
+  cp_com_delta_t com_delta;
+  memset(&com_delta, 0, sizeof(com_delta));
+  com_delta.opcode = COMMIT_DELTA_OP;
+  com_delta.rmw_opcode = FETCH_AND_ADD;
+  com_delta.val_len = sizeof(uint64_t);
+  com_delta.t_rmw_id = rmw_id;
+  com_delta.log_no = log_no;
+  assign_ts_to_netw_ts(&com_delta.base_ts, &kv_ptr->ts);
+  memcpy(com_delta.operand, &addend, sizeof(uint64_t));
+  commit_rmw(kv_ptr, (void *) &com_delta, NULL, FROM_REMOTE_COMMIT, T_ID);
+}
+
+// A receiver that holds the value the F&A was applied on rebuilds the new value
+static void test_com_delta_applied_on_base(void)
+{
+  mica_op_t kv_ptr;
+  reset_registry();
+  init_kv_ptr(&kv_ptr, 4, 10);
+
+  commit_delta(&kv_ptr, RMW_ID(3, 1), 5, 5);
+  CHECK(kv_ptr.last_committed_log_no == 5);
+  CHECK(kv_ptr_val(&kv_ptr) == 15);
+  CHECK(committed_glob_sess_rmw_id(3) == RMW_ID(3, 1));
+}
+
+// A receiver that has accepted the RMW commits the accepted value
+static void test_com_delta_takes_accepted_value(void)
+{
+  mica_op_t kv_ptr;
+  reset_registry();
+  init_kv_ptr(&kv_ptr, 4, 10);
+  kv_ptr_accepts(&kv_ptr, RMW_ID(3, 1), 5, 15);
+
+  commit_delta(&kv_ptr, RMW_ID(3, 1), 5, 5);
+  CHECK(kv_ptr.last_committed_log_no == 5);
+  CHECK(kv_ptr.state == INVALID_RMW);
+  CHECK(kv_ptr_val(&kv_ptr) == 15);
+}
+
+/* ---------------------------------------------------------------------------
+//------------------------------ COMMIT RANGES -------------------------------
+//---------------------------------------------------------------------------*/
+
+// A range that commits slots first_log ... first_log + 2, by sessions 1, 2 and 3,
+// with val as the value of the last slot
+static void commit_range_of_three(mica_op_t *kv_ptr, uint32_t first_log, uint64_t val)
+{
+  uint8_t buf[COM_RANGE_SIZE(3)];
+  cp_com_range_t *range = (cp_com_range_t *) buf;
+  memset(buf, 0, sizeof(buf));
+  range->opcode = COMMIT_RANGE_OP;
+  range->count = 3;
+  range->t_rmw_id = RMW_ID(1, 1);
+  range->first_log = first_log;
+  range->t_rmw_ids[0] = RMW_ID(2, 1);
+  range->t_rmw_ids[1] = RMW_ID(3, 1);
+  range->base_ts.version = kv_ptr->ts.version + 6;
+  memcpy(range->value, &val, sizeof(uint64_t));
+  commit_rmw(kv_ptr, (void *) range, NULL, FROM_REMOTE_COMMIT, T_ID);
+}
+
+// The range commits its last slot with its value, and registers the rmw-id of every slot
+static void test_com_range_expands_to_every_slot(void)
+{
+  mica_op_t kv_ptr;
+  reset_registry();
+  init_kv_ptr(&kv_ptr, 4, 10);
+
+  commit_range_of_three(&kv_ptr, 5, 42);
+  CHECK(kv_ptr.last_committed_log_no == 7);
+  CHECK(kv_ptr.last_committed_rmw_id.id == RMW_ID(3, 1));
+  CHECK(kv_ptr_val(&kv_ptr) == 42);
+  CHECK(committed_glob_sess_rmw_id(1) == RMW_ID(1, 1));
+  CHECK(committed_glob_sess_rmw_id(2) == RMW_ID(2, 1));
+  CHECK(committed_glob_sess_rmw_id(3) == RMW_ID(3, 1));
+}
+
+// A receiver that has committed the first slots of the range and accepted the last one
+// still commits the value of the range
+static void test_com_range_over_committed_slots(void)
+{
+  mica_op_t kv_ptr;
+  reset_registry();
+  init_kv_ptr(&kv_ptr, 6, 10);
+  kv_ptr_accepts(&kv_ptr, RMW_ID(3, 1), 7, 42);
+
+  commit_range_of_three(&kv_ptr, 5, 42);
+  CHECK(kv_ptr.last_committed_log_no == 7);
+  CHECK(kv_ptr.state == INVALID_RMW);
+  CHECK(kv_ptr_val(&kv_ptr) == 42);
+  CHECK(committed_glob_sess_rmw_id(1) == RMW_ID(1, 1));
+  CHECK(committed_glob_sess_rmw_id(3) == RMW_ID(3, 1));
+}
+
+/* ---------------------------------------------------------------------------
+//------------------------------ COMBINED F&As -------------------------------
+//---------------------------------------------------------------------------*/
+
+static void init_combined_fetch_and_add(loc_entry_t *loc_entry, uint8_t *addend_buf,
+                                        uint16_t sess_id, uint64_t addend)
+{
+  memset(loc_entry, 0, sizeof(loc_entry_t));
+  loc_entry->sess_id = sess_id;
+  loc_entry->opcode = FETCH_AND_ADD;
+  loc_entry->state = COMBINED;
+  loc_entry->rmw_val_len = 2 * sizeof(uint64_t);
+  loc_entry->compare_val = addend_buf;
+  memcpy(addend_buf, &addend, sizeof(uint64_t));
+}
+
+// Every F&A that rode on the owner reads the value the owner read,
+// with the prefix sum of the addends before its own in the first word
+static void test_combined_rmws_read_prefix_sums(void)
+{
+  bool stalled[3] = {true, true, true};
+  sess_stall_t stall_info = {.stalled = stalled, .all_stalled = true};
+  uint8_t addends[3][RMW_VALUE_SIZE];
+  loc_entry_t entries[3];
+  for (uint16_t i = 0; i < 3; i++)
+    init_combined_fetch_and_add(&entries[i], addends[i], i, 10 * (i + 1));
+
+  loc_entry_t *owner = &entries[0];
+  uint64_t read_value[2] = {100, 7};
+  memcpy(owner->value_to_read, read_value, sizeof(read_value));
+  owner->state = COMMITTED;
+  owner->rmw_is_successful = true;
+  owner->combined_next = &entries[1];
+  entries[1].combined_next = &entries[2];
+
+  free_combined_rmws(owner, &stall_info, T_ID);
+  uint64_t *first = (uint64_t *) entries[1].value_to_read;
+  uint64_t *second = (uint64_t *) entries[2].value_to_read;
+  CHECK(first[0] == 110 && first[1] == 7);
+  CHECK(second[0] == 130 && second[1] == 7);
+  CHECK(entries[1].state == INVALID_RMW && entries[2].state == INVALID_RMW);
+  CHECK(entries[1].rmw_is_successful && entries[2].rmw_is_successful);
+  CHECK(!stalled[1] && !stalled[2]);
+  CHECK(owner->combined_next == NULL && entries[1].combined_next == NULL);
+}
+
+/* ---------------------------------------------------------------------------
+//------------------------------ STRIPED COUNTERS ----------------------------
+//---------------------------------------------------------------------------*/
+
+// Stripe s of the counter has committed log 3 with the value s + 1
+static void init_striped_read(loc_entry_t *loc_entry, loc_entry_t *help_loc_entry,
+                              mica_op_t *stripes, mica_op_t **stripe_kv_ptrs)
+{
+  memset(loc_entry, 0, sizeof(loc_entry_t));
+  memset(help_loc_entry, 0, sizeof(loc_entry_t));
+  loc_entry->sess_id = 1;
+  loc_entry->l_id = 1;
+  loc_entry->help_loc_entry = help_loc_entry;
+  for (uint16_t s = 0; s < COUNTER_STRIPES; s++) {
+    init_kv_ptr(&stripes[s], 3, s + 1);
+    stripe_kv_ptrs[s] = &stripes[s];
+  }
+  loc_entry->stripe_kv_ptrs = stripe_kv_ptrs;
+  rearm_loc_entry_for_striped_read(loc_entry, T_ID);
+}
+
+// The remote replies that complete the quorum of a stripe
+static void stripe_gathers_remote_reps(loc_entry_t *loc_entry, mica_op_t *stripe_kv_ptr,
+                                       uint16_t stripe, uint32_t log_no, uint64_t counter)
+{
+  ts_tuple_t ts = stripe_kv_ptr->ts;
+  ts.version += 2 * (log_no - stripe_kv_ptr->last_committed_log_no);
+  for (uint8_t rep_i = 1; rep_i < QUORUM_NUM; rep_i++) {
+    int rep_stripe = stripe_of_read_l_id(loc_entry, stripe_read_l_id(loc_entry, stripe));
+    CHECK(rep_stripe == stripe);
+    stripe_read_gathers_rep(loc_entry, (uint16_t) rep_stripe, log_no, &ts, (uint8_t *) &counter);
+  }
+}
+
+// The quorum reads of all the stripes are in flight together, and each reply finds its stripe
+// by its l_id. The read is ready once every stripe has a quorum, with the newest value of each
+static void test_striped_read_gathers_every_stripe(void)
+{
+  mica_op_t stripes[COUNTER_STRIPES];
+  mica_op_t *stripe_kv_ptrs[COUNTER_STRIPES];
+  loc_entry_t loc_entry, help_loc_entry;
+  init_striped_read(&loc_entry, &help_loc_entry, stripes, stripe_kv_ptrs);
+  CHECK(loc_entry.state == QUORUM_READ && loc_entry.stripes_read == 0);
+  CHECK(stripe_of_read_l_id(&loc_entry, loc_entry.l_id) == COUNTER_STRIPES - 1);
+  CHECK(stripe_of_read_l_id(&loc_entry, loc_entry.l_id + SESSIONS_PER_THREAD) == -1);
+  CHECK(stripe_of_read_l_id(&loc_entry, stripe_read_l_id(&loc_entry, 0) - SESSIONS_PER_THREAD) == -1);
+
+  // the replies arrive from the last stripe back, and the first stripe hears of a newer commit
+  uint64_t expected_sum = 100;
+  for (int s = COUNTER_STRIPES - 1; s > 0; s--) {
+    CHECK(!loc_entry.rmw_reps.ready_to_inspect);
+    stripe_gathers_remote_reps(&loc_entry, &stripes[s], (uint16_t) s, 3, (uint64_t) s + 1);
+    expected_sum += (uint64_t) s + 1;
+  }
+  CHECK(!loc_entry.rmw_reps.ready_to_inspect);
+  stripe_gathers_remote_reps(&loc_entry, &stripes[0], 0, 4, 100);
+  CHECK(loc_entry.rmw_reps.ready_to_inspect && loc_entry.stripes_read == COUNTER_STRIPES);
+
+  uint64_t sum = 0;
+  for (uint16_t s = 0; s < COUNTER_STRIPES; s++)
+    sum += loc_entry.stripe_reads[s].counter;
+  CHECK(sum == expected_sum);
+}
+
+// Reading the stripes again keeps those that have a quorum, and moves the rest to new l_ids
+static void test_striped_read_again_keeps_read_stripes(void)
+{
+  mica_op_t stripes[COUNTER_STRIPES];
+  mica_op_t *stripe_kv_ptrs[COUNTER_STRIPES];
+  loc_entry_t loc_entry, help_loc_entry;
+  init_striped_read(&loc_entry, &help_loc_entry, stripes, stripe_kv_ptrs);
+  stripe_gathers_remote_reps(&loc_entry, &stripes[0], 0, 4, 100);
+  stripe_read_gathers_rep(&loc_entry, 1, 3, &stripes[1].ts, stripes[1].value);
+  uint64_t old_l_id = loc_entry.l_id;
+
+  rearm_loc_entry_for_striped_read(&loc_entry, T_ID);
+  CHECK(stripe_of_read_l_id(&loc_entry, old_l_id) == -1);
+  CHECK(loc_entry.stripes_read == 1 && !loc_entry.rmw_reps.ready_to_inspect);
+  CHECK(loc_entry.stripe_reads[0].replies == QUORUM_NUM && loc_entry.stripe_reads[0].counter == 100);
+  CHECK(loc_entry.stripe_reads[1].replies == 1 && loc_entry.stripe_reads[1].counter == 2);
+}
+
+/* ---------------------------------------------------------------------------
+//------------------------------ LOG TOO HIGH --------------------------------
+//---------------------------------------------------------------------------*/
+
+static void propose_is_nacked_log_too_high(loc_entry_t *loc_entry)
+{
+  loc_entry->state = PROPOSED;
+  react_on_log_too_high_for_prop(loc_entry, T_ID);
+}
+
+// The first LOG_TOO_HIGH nack only retries. The previous commit is pushed on the second nack
+// in a row with LOG_TOO_HIGH_PUSH, and after LOG_TOO_HIGH_TIME_OUT nacks without it
+static void test_log_too_high_pushes_only_on_repeated_nack(void)
+{
+  mica_op_t kv_ptr;
+  loc_entry_t loc_entry, help_loc_entry;
+  init_kv_ptr(&kv_ptr, 5, 42);
+  kv_ptr.last_committed_rmw_id.id = RMW_ID(2, 1);
+  memset(&loc_entry, 0, sizeof(loc_entry_t));
+  memset(&help_loc_entry, 0, sizeof(loc_entry_t));
+  loc_entry.help_loc_entry = &help_loc_entry;
+  loc_entry.kv_ptr = &kv_ptr;
+  loc_entry.new_ts.version = 4;
+
+  propose_is_nacked_log_too_high(&loc_entry);
+  CHECK(loc_entry.state == RETRY_WITH_BIGGER_TS);
+  CHECK(loc_entry.log_too_high_cntr == 1 && loc_entry.new_ts.version == 5);
+
+  uint16_t nacks_to_push = LOG_TOO_HIGH_PUSH ? 2 : LOG_TOO_HIGH_TIME_OUT;
+  for (uint16_t nack = 2; nack < nacks_to_push; nack++) {
+    propose_is_nacked_log_too_high(&loc_entry);
+    CHECK(loc_entry.state == RETRY_WITH_BIGGER_TS);
+  }
+  propose_is_nacked_log_too_high(&loc_entry);
+  CHECK(loc_entry.state == MUST_BCAST_COMMITS_FROM_HELP && loc_entry.log_too_high_cntr == 0);
+  CHECK(loc_entry.helping_flag == HELP_PREV_COMMITTED_LOG_TOO_HIGH);
+  CHECK(help_loc_entry.log_no == 5 && help_loc_entry.rmw_id.id == RMW_ID(2, 1));
+  uint64_t pushed_val;
+  memcpy(&pushed_val, help_loc_entry.value_to_write, sizeof(uint64_t));
+  CHECK(pushed_val == 42);
+}
+
+
+int main(int argc, char *argv[])
+{
+  test_com_no_val_takes_accepted_value();
+  test_com_no_val_dropped_on_other_rmw_id();
+  test_com_no_val_dropped_on_other_log();
+  test_com_no_val_on_committed_log();
+  test_apply_shipped_rmw_op();
+  test_rmw_operators_on_short_values();
+  test_com_delta_applied_on_base();
+  test_com_delta_takes_accepted_value();
+  test_commit_ships_rmw_op_unless_base_is_missed();
+  test_acc_range_patches_base_value();
+  test_nacked_acc_carries_whole_value();
+  test_com_range_expands_to_every_slot();
+  test_com_range_over_committed_slots();
+  test_combined_rmws_read_prefix_sums();
+  test_striped_read_gathers_every_stripe();
+  test_striped_read_again_keeps_read_stripes();
+  test_log_too_high_pushes_only_on_repeated_nack();
+  printf("%d checks passed \n", checks_run);
+  return 0;
+}
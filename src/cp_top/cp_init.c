@@ -8,12 +8,25 @@
 #include <cp_netw_structs.h>
 #include "od_network_context.h"
 #include <od_init_func.h>
+#include <stddef.h>
 
-atomic_uint_fast64_t committed_glob_sess_rmw_id[GLOBAL_SESSION_NUM];
+committed_rmw_id_slot_t committed_rmw_id_registry[GLOBAL_SESSION_NUM];
 FILE* client_log[CLIENTS_PER_MACHINE];
+cp_params_t cp_params = {
+    .prop_credits = PROP_CREDITS - LAGGARD_HEADROOM,
+    .acc_credits = ACC_CREDITS - LAGGARD_HEADROOM,
+    .com_credits = COM_CREDITS - LAGGARD_HEADROOM,
+    .prop_coalesce = PROP_COALESCE,
+    .acc_coalesce = ACC_COALESCE,
+    .com_coalesce = MAX_COM_COALESCE,
+    .auto_tune_credits = false,
+    .retry_back_off_base = RETRY_BACK_OFF_BASE,
+    .retry_back_off_cap = RETRY_BACK_OFF_CAP
+};
 
 void cp_init_functionality(int argc, char *argv[])
 {
+  argc = cp_handle_program_inputs(argc, argv);
   cp_print_parameters_in_the_start();
   od_generic_static_assert_compile_parameters();
   cp_static_assert_compile_parameters();
@@ -22,6 +35,51 @@ void cp_init_functionality(int argc, char *argv[])
   od_handle_program_inputs(argc, argv);
 }
 
+static uint16_t cp_parse_bounded_param(const char *name, const char *arg,
+                                       uint16_t max)
+{
+  long val = strtol(arg, NULL, 10);
+  if (val < 1 || val > max) {
+    my_printf(red, "%s must be in [1, %u], got %s \n", name, max, arg);
+    exit(EXIT_FAILURE);
+  }
+  return (uint16_t) val;
+}
+
+// Consumes the cp-specific flags and leaves the rest for odyssey;
+// returns the number of remaining arguments
+int cp_handle_program_inputs(int argc, char *argv[])
+{
+  int kept = 1;
+  for (int i = 1; i < argc; i++) {
+    bool has_val = i + 1 < argc;
+    if (strcmp(argv[i], "--auto-tune-credits") == 0)
+      cp_params.auto_tune_credits = true;
+    else if (has_val && strcmp(argv[i], "--prop-credits") == 0)
+      cp_params.prop_credits = cp_parse_bounded_param(argv[i], argv[++i],
+                                                      PROP_CREDITS - LAGGARD_HEADROOM);
+    else if (has_val && strcmp(argv[i], "--acc-credits") == 0)
+      cp_params.acc_credits = cp_parse_bounded_param(argv[i], argv[++i],
+                                                     ACC_CREDITS - LAGGARD_HEADROOM);
+    else if (has_val && strcmp(argv[i], "--com-credits") == 0)
+      cp_params.com_credits = cp_parse_bounded_param(argv[i], argv[++i],
+                                                     COM_CREDITS - LAGGARD_HEADROOM);
+    else if (has_val && strcmp(argv[i], "--prop-coalesce") == 0)
+      cp_params.prop_coalesce = cp_parse_bounded_param(argv[i], argv[++i], PROP_COALESCE);
+    else if (has_val && strcmp(argv[i], "--acc-coalesce") == 0)
+      cp_params.acc_coalesce = cp_parse_bounded_param(argv[i], argv[++i], ACC_COALESCE);
+    else if (has_val && strcmp(argv[i], "--com-coalesce") == 0)
+      cp_params.com_coalesce = cp_parse_bounded_param(argv[i], argv[++i], MAX_COM_COALESCE);
+    else if (has_val && strcmp(argv[i], "--retry-back-off-base") == 0)
+      cp_params.retry_back_off_base = cp_parse_bounded_param(argv[i], argv[++i], RETRY_BACK_OFF_MAX);
+    else if (has_val && strcmp(argv[i], "--retry-back-off-cap") == 0)
+      cp_params.retry_back_off_cap = cp_parse_bounded_param(argv[i], argv[++i], RETRY_BACK_OFF_MAX);
+    else argv[kept++] = argv[i];
+  }
+  argv[kept] = NULL;
+  return kept;
+}
+
 
 void cp_static_assert_compile_parameters()
 {
@@ -32,6 +90,8 @@ void cp_static_assert_compile_parameters()
   static_assert(!(COMMIT_LOGS && (PRINT_LOGS || VERIFY_PAXOS)), " ");
   static_assert(sizeof(struct key) == KEY_SIZE, " ");
   static_assert(sizeof(struct network_ts_tuple) == TS_TUPLE_SIZE, "");
+  static_assert(RETRY_BACK_OFF_BASE <= RETRY_BACK_OFF_CAP && RETRY_BACK_OFF_CAP <= RETRY_BACK_OFF_MAX,
+                "the back-off defaults must be within the bound of their flags");
 
  static_assert(INVALID_RMW == 0, "the initial state of a mica_op must be invalid");
   static_assert(MACHINE_NUM < 16, "the bit_vec vector is 16 bits-- can be extended");
@@ -48,6 +108,9 @@ void cp_static_assert_compile_parameters()
   static_assert(PROP_COALESCE > 0, "");
   static_assert(ACC_COALESCE > 0, "");
   static_assert(COM_COALESCE > 0, "");
+  static_assert(!ADAPTIVE_ALL_ABOARD || ENABLE_ALL_ABOARD, "the estimator only picks between All-aboard and Classic");
+  static_assert(LAGGARD_HEADROOM < MIN(PROP_CREDITS, MIN(ACC_CREDITS, COM_CREDITS)),
+                "the laggards' headroom is carved out of the credits");
 
   // NETWORK STRUCTURES
 
@@ -55,9 +118,20 @@ void cp_static_assert_compile_parameters()
   static_assert(sizeof(cp_prop_mes_t) == PROP_MES_SIZE, "");
   static_assert(sizeof(cp_acc_mes_t) == ACC_MES_SIZE, "");
   static_assert(sizeof(cp_acc_t) == ACC_SIZE, "");
+  static_assert(sizeof(cp_acc_range_t) == ACC_RANGE_SIZE(0), "");
+  static_assert(offsetof(cp_acc_range_t, val_offset) == offsetof(cp_acc_t, value), "");
   static_assert(PROP_REP_ACCEPTED_SIZE == PROP_REP_LOG_TOO_LOW_SIZE + 1, "");
   static_assert(sizeof(cp_rmw_rep_t) == PROP_REP_ACCEPTED_SIZE, "");
   static_assert(sizeof(cp_com_t) == COM_SIZE, "");
+  static_assert(sizeof(cp_com_range_t) == COM_SIZE, "");
+  static_assert(sizeof(cp_com_delta_t) == COM_DELTA_SIZE, "");
+  static_assert(COMMIT_DELTA_OP > NOP && COMMIT_DELTA_OP < RMW_OPERATOR_BASE, "");
+  static_assert(offsetof(cp_com_delta_t, log_no) == offsetof(cp_com_t, log_no), "");
+  static_assert(!SHIP_RMW_OPS_IN_COMMITS || COM_DELTA_SIZE < COM_SIZE,
+                "shipping the operation pays off only for values bigger than the operand");
+  static_assert(offsetof(cp_com_range_t, first_log) == offsetof(cp_com_t, log_no), "");
+  static_assert(offsetof(cp_com_range_t, value) == offsetof(cp_com_t, value), "");
+  static_assert(MAX_COM_COALESCE < 256, "the range count is stored in uint8_t");
   // UD- REQS
   static_assert(sizeof(cp_prop_mes_ud_t) == PROP_RECV_SIZE, "");
   static_assert(sizeof(cp_acc_mes_ud_t) == ACC_RECV_SIZE, "");
@@ -70,18 +144,30 @@ void cp_static_assert_compile_parameters()
   // RMWs
   static_assert(!ENABLE_RMWS || LOCAL_PROP_NUM >= SESSIONS_PER_THREAD, "");
   static_assert(GLOBAL_SESSION_NUM < K_64, "global session ids are stored in uint16_t");
+  static_assert(!PAD_COMMITTED_RMW_IDS || sizeof(committed_rmw_id_slot_t) == 64, "one cache line per session");
+  static_assert(!LAZY_COMMITS || ENABLE_COMMITS_WITH_NO_VAL, "only commits without a value are deferred");
 
   static_assert(!(VERIFY_PAXOS && PRINT_LOGS), "only one of those can be set");
 #if VERIFY_PAXOS == 1
   static_assert(EXIT_ON_PRINT == 1, "");
 #endif
   static_assert(TRACE_ONLY_CAS + TRACE_ONLY_FA + TRACE_MIXED_RMWS == 1, "");
+  static_assert(RMW_OPERATOR_BASE > NOP && RMW_OPERATOR_BASE + RMW_OPERATOR_NUM <= 256,
+                "the RMW operators need a range of their own in the uint8_t opcodes");
+  static_assert(!STRIPED_COUNTERS || (COUNTER_STRIPES >= 1 && COUNTER_KEY_SHARE >= 1 &&
+                                      2 * STRIPED_COUNTER_NUM * COUNTER_STRIPES <= KVS_NUM_KEYS),
+                "the stripes are keys of the KVS, and the session keys they displace move below them");
+  static_assert(!(SHIP_RMW_OPS_IN_COMMITS && READ_LEASES),
+                "a lease holder that drops a commit it cannot apply would serve an older value");
+  static_assert(!(STRIPED_COUNTERS && EARLY_RMW_COMPLETION),
+                "the sum of the stripes would miss an add completed before it committed in a quorum");
 
 }
 
 void cp_print_parameters_in_the_start()
 {
-  emphatic_print(green, ENABLE_ALL_ABOARD ? "ALL-ABOARD PAXOS" : "CLASSIC PAXOS");
+  emphatic_print(green, !ENABLE_ALL_ABOARD ? "CLASSIC PAXOS" :
+                        ADAPTIVE_ALL_ABOARD ? "ALL-ABOARD PAXOS ON UNCONTENDED KEYS" : "ALL-ABOARD PAXOS");
   if (ENABLE_ASSERTIONS) {
 
     printf("MICA OP capacity %ld/%d added padding %d  \n",
@@ -89,11 +175,24 @@ void cp_print_parameters_in_the_start()
 
     printf("quorum-num %d \n", QUORUM_NUM);
   }
+  printf("Credits: props %u/%u, accs %u/%u, coms %u/%u%s \n",
+         cp_params.prop_credits, PROP_CREDITS,
+         cp_params.acc_credits, ACC_CREDITS,
+         cp_params.com_credits, COM_CREDITS,
+         cp_params.auto_tune_credits ? " (auto-tuned at start-up)" : "");
+  printf("Coalescing: props %u/%u, accs %u/%u, coms %u/%u \n",
+         cp_params.prop_coalesce, PROP_COALESCE,
+         cp_params.acc_coalesce, ACC_COALESCE,
+         cp_params.com_coalesce, MAX_COM_COALESCE);
+  if (RETRY_BACK_OFF)
+    printf("Retry back-off: base %u (default %u), cap %u (default %u) inspections \n",
+           cp_params.retry_back_off_base, RETRY_BACK_OFF_BASE,
+           cp_params.retry_back_off_cap, RETRY_BACK_OFF_CAP);
 }
 
 void cp_init_globals()
 {
-  memset(committed_glob_sess_rmw_id, 0, GLOBAL_SESSION_NUM * sizeof(uint64_t));
+  memset(committed_rmw_id_registry, 0, sizeof(committed_rmw_id_registry));
 }
 
 // If reading CAS rmws out of the trace, CASes that compare against 0 succeed the rest fail
@@ -188,7 +287,7 @@ void cp_init_qp_meta(context_t *ctx)
                      REM_MACH_NUM, REM_MACH_NUM, PROP_BUF_SLOTS,
                      PROP_RECV_SIZE, PROP_MES_SIZE, ENABLE_MULTICAST, ENABLE_MULTICAST,
                      PROP_SEND_MCAST_QP, 0, PROP_FIFO_SIZE,
-                     PROP_CREDITS, PROP_MES_HEADER,
+                     cp_params.prop_credits, PROP_MES_HEADER,
                      "send props", "recv props");
 
   create_per_qp_meta(&qp_meta[RMW_REP_QP_ID], MAX_RMW_REP_WRS,
@@ -207,7 +306,7 @@ void cp_init_qp_meta(context_t *ctx)
                      REM_MACH_NUM, REM_MACH_NUM, ACC_BUF_SLOTS,
                      ACC_RECV_SIZE, ACC_MES_SIZE, ENABLE_MULTICAST, ENABLE_MULTICAST,
                      ACC_SEND_MCAST_QP, 0, ACC_FIFO_SIZE,
-                     ACC_CREDITS, ACC_MES_HEADER,
+                     cp_params.acc_credits, ACC_MES_HEADER,
                      "send accepts", "recv accepts");
 
   //create_per_qp_meta(&qp_meta[ACC_REP_QP_ID], MAX_ACC_REP_WRS,
@@ -225,7 +324,7 @@ void cp_init_qp_meta(context_t *ctx)
                      REM_MACH_NUM, REM_MACH_NUM, COM_BUF_SLOTS,
                      COM_RECV_SIZE, COM_MES_SIZE, ENABLE_MULTICAST, ENABLE_MULTICAST,
                      COM_SEND_MCAST_QP, 0, COM_FIFO_SIZE,
-                     COM_CREDITS, COM_MES_HEADER,
+                     cp_params.com_credits, COM_MES_HEADER,
                      "send commits", "recv commits");
   ///
 
@@ -3,11 +3,44 @@
 #include <cp_opcodes.h>
 #include <cp_stats.h>
 #include <cp_config.h>
+#include <cp_messages.h>
 
 
 void print_latency_stats(void);
 
+cp_stats_t cp_t_stats[WORKERS_PER_MACHINE];
+static cp_stats_t cp_prev_stats[WORKERS_PER_MACHINE];
+static cp_stats_t cp_per_t[WORKERS_PER_MACHINE];
+static cp_stats_t cp_aggreg;
 
+#define CP_STATS_WORDS (sizeof(cp_stats_t) / sizeof(uint64_t))
+
+// What the cp counters of each worker grew by since the last print
+static inline void get_all_cp_stats(void)
+{
+  memset(&cp_aggreg, 0, sizeof(cp_stats_t));
+  for (int i = 0; i < WORKERS_PER_MACHINE; i++) {
+    uint64_t *curr = (uint64_t *) &cp_t_stats[i];
+    uint64_t *prev = (uint64_t *) &cp_prev_stats[i];
+    uint64_t *per_t = (uint64_t *) &cp_per_t[i];
+    uint64_t *aggreg = (uint64_t *) &cp_aggreg;
+    for (uint32_t w = 0; w < CP_STATS_WORDS; w++) {
+      uint64_t now = curr[w];
+      per_t[w] = now - prev[w];
+      aggreg[w] += per_t[w];
+      prev[w] = now;
+    }
+  }
+}
+
+
+
+// Out of the RMWs that could go All-aboard, the fraction the conflict estimator let through
+static inline double all_aboard_pick_ratio(cp_stats_t *st)
+{
+  uint64_t picks = st->all_aboard_picks + st->classic_picks;
+  return picks == 0 ? 0 : (double) st->all_aboard_picks / (double) picks;
+}
 
 static inline void show_aggregate_stats(stats_ctx_t *ctx)
 {
@@ -21,6 +54,71 @@ static inline void show_aggregate_stats(stats_ctx_t *ctx)
             all_aggreg->qp_stats[PROP_QP_ID].sent,
             (double) all_aggreg->cancelled_rmws /
             (double) all_aggreg->total_reqs);
+  if (PRIORITY_SEND_SCHEDULING)
+    my_printf(green, "Deferred prop loops: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.deferred_prop_loops));
+  if (QUORUM_CREDIT_BCASTS)
+    my_printf(green, "Credits lent to laggards: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.lent_credits));
+  if (PROPOSER_LEASE_SLOTS)
+    my_printf(green, "RMWs on proposer leases: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.leased_rmws));
+  if (ENABLE_ALL_ABOARD && ADAPTIVE_ALL_ABOARD)
+    my_printf(green, "All-aboard picked for %.2f of the RMWs \n",
+              all_aboard_pick_ratio(&cp_aggreg));
+  if (THRIFTY_QUORUMS)
+    my_printf(green, "Thrifty sends: %.2f/s, widenings: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.thrifty_sends),
+              per_sec(ctx, cp_aggreg.quorum_widenings));
+  if (ENABLE_QUORUM_READS)
+    my_printf(green, "Quorum reads: %.2f/s, fell back to F&A: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.quorum_reads),
+              per_sec(ctx, cp_aggreg.quorum_read_fallbacks));
+  if (READ_LEASES)
+    my_printf(green, "Read lease hits: %.2f/s, misses: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.read_lease_hits),
+              per_sec(ctx, cp_aggreg.read_lease_misses));
+  my_printf(green, "Retries after higher-ballot nacks: %.2f/s, back-off inspections: %.2f/s \n",
+            per_sec(ctx, cp_aggreg.nacked_retries),
+            per_sec(ctx, cp_aggreg.retry_back_off_waits));
+  if (AGE_PRIORITY)
+    my_printf(green, "Deferrals to older RMWs: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.priority_deferrals));
+  if (COMBINE_FETCH_AND_ADDS)
+    my_printf(green, "F&As combined into the RMW of another session: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.combined_faas));
+  if (HANDOFF_QUEUE)
+    my_printf(green, "RMWs queued behind a local owner: %.2f/s, handed the kv_ptr: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.handoff_queued),
+              per_sec(ctx, cp_aggreg.handoffs));
+  if (EARLY_RMW_COMPLETION && !READ_LEASES)
+    my_printf(green, "RMWs completed at the accept quorum: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.early_completions));
+  if (LAZY_COMMITS)
+    my_printf(green, "Deferred commits: %.2f/s, flushed: %.2f/s, implied remotely: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.lazy_commits),
+              per_sec(ctx, cp_aggreg.lazy_commit_flushes),
+              per_sec(ctx, cp_aggreg.implied_commits));
+  if (SHIP_RMW_OPS_IN_COMMITS)
+    my_printf(green, "Commits shipping the operation: %.2f/s, rebuilt: %.2f/s, ignored: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.shipped_rmw_ops),
+              per_sec(ctx, cp_aggreg.rebuilt_rmw_ops),
+              per_sec(ctx, cp_aggreg.ignored_rmw_ops));
+  if (PARTIAL_VALUE_RMWS || SHIP_RMW_OPS_IN_COMMITS)
+    my_printf(green, "Accepts carrying a range of the value: %.2f/s, nacked: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.acc_val_ranges),
+              per_sec(ctx, cp_aggreg.nacked_acc_val_ranges));
+  if (STRIPED_COUNTERS)
+    my_printf(green, "Reads summing counter stripes: %.2f/s, stripes read again: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.striped_reads),
+              per_sec(ctx, cp_aggreg.stripe_rereads));
+  if (LOG_TOO_HIGH_PUSH)
+    my_printf(green, "Previous commits pushed on LOG_TOO_HIGH: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.log_too_high_pushes));
+  if (ENABLE_COMMIT_RANGES)
+    my_printf(green, "Commits folded into ranges: %.2f/s, bytes saved: %.2f/s \n",
+              per_sec(ctx, cp_aggreg.com_range_slots),
+              per_sec(ctx, cp_aggreg.com_range_slots * (COM_SIZE - sizeof(uint64_t))));
 }
 
 static inline void show_per_thread_stats(stats_ctx_t *ctx)
@@ -49,6 +147,21 @@ static inline void show_per_thread_stats(stats_ctx_t *ctx)
               get_batch(ctx, &all_per_t[i].qp_stats[COM_QP_ID]),
               get_batch(ctx, &all_per_t[i].qp_stats[RMW_REP_QP_ID]),
               get_batch(ctx, &all_per_t[i].qp_stats[ACK_QP_ID]));
+    if (PRIORITY_SEND_SCHEDULING)
+      my_printf(yellow, ", Deferred props %.2f/s",
+                per_sec(ctx, cp_per_t[i].deferred_prop_loops));
+    if (QUORUM_CREDIT_BCASTS)
+      my_printf(yellow, ", Lent credits %.2f/s",
+                per_sec(ctx, cp_per_t[i].lent_credits));
+    if (PROPOSER_LEASE_SLOTS)
+      my_printf(yellow, ", Leased RMWs %.2f/s",
+                per_sec(ctx, cp_per_t[i].leased_rmws));
+    if (ENABLE_ALL_ABOARD && ADAPTIVE_ALL_ABOARD)
+      my_printf(yellow, ", Ab picks %.2f",
+                all_aboard_pick_ratio(&cp_per_t[i]));
+    if (THRIFTY_QUORUMS)
+      my_printf(yellow, ", Widenings %.2f/s",
+                per_sec(ctx, cp_per_t[i].quorum_widenings));
     printf("\n");
   }
   printf("\n");
@@ -62,6 +175,7 @@ void cp_stats(stats_ctx_t *ctx)
 {
   get_all_wrkr_stats(ctx, WORKERS_PER_MACHINE, sizeof(t_stats_t));
   memcpy(ctx->prev_w_stats, ctx->curr_w_stats, WORKERS_PER_MACHINE * (sizeof(t_stats_t)));
+  get_all_cp_stats();
 
   if (SHOW_AGGREGATE_STATS)
     show_aggregate_stats(ctx);